@@ -0,0 +1,469 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Buffer cache.
+
+   Every sector of the file system device is read and written
+   through a cache of CACHE_SECTORS sectors.  Reading a cached
+   sector does not touch the disk.  Writes only modify the cached
+   copy and mark it dirty; a dirty sector is written back when it
+   is evicted or when cache_flush() is called, which the sync
+   system call and filesys_done() do.  Replacement uses the clock
+   algorithm over an accessed bit.
+
+   Dirty sectors do not stay in memory indefinitely: the
+   "flusher" kernel thread wakes every half FLUSH_AGE ticks and
+   writes back the sectors that have been dirty for FLUSH_AGE
+   ticks or longer.  A writer that leaves more than DIRTY_LIMIT
+   sectors dirty is throttled by having to write all of them
+   back itself before it returns.  Both write back their sectors
+   as one batch in ascending sector order, so that a burst of
+   small writes reaches the disk as a few sequential runs.
+
+   A single lock protects the cache.  Disk I/O happens without
+   it: the entry being read or written is marked busy, and
+   anyone who wants that entry waits on IO_DONE until the I/O
+   completes.  A dirty entry is never busy.  Copies to and from the cache are done with the
+   lock held.
+
+   cache_readahead() queues a sector to be read in by the
+   "readahead" kernel thread, so that a sequential reader (see
+   file_read()) finds the next sectors already cached instead of
+   waiting for each one.  Requests for sectors that are already
+   cached or queued, or that do not fit in the queue, are
+   dropped. */
+
+/* Number of cached sectors. */
+#define CACHE_SECTORS 64
+
+/* Cache entry. */
+struct cache_entry
+  {
+    block_sector_t sector;      /* Cached sector, or CACHE_EMPTY. */
+    bool dirty;                 /* Modified since read or written back? */
+    bool accessed;              /* Used since the clock hand passed? */
+    bool busy;                  /* Disk I/O in progress? */
+    int64_t dirty_since;        /* Tick at which it became dirty. */
+    uint8_t *data;              /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+/* SECTOR value of an entry that holds no sector. */
+#define CACHE_EMPTY ((block_sector_t) -1)
+
+/* Maximum number of queued read-ahead requests. */
+#define RA_QUEUE_SIZE 32
+
+static struct cache_entry cache[CACHE_SECTORS];
+static struct lock cache_lock;
+static struct condition io_done;    /* Signaled when an entry's I/O ends. */
+static size_t hand;                 /* Clock hand. */
+static size_t dirty_cnt;            /* Number of dirty entries. */
+
+/* Write-behind parameters, set with cache_set_writeback(). */
+static int64_t flush_age = TIMER_FREQ;          /* In timer ticks. */
+static size_t dirty_limit = CACHE_SECTORS / 2;  /* In sectors. */
+
+/* Read-ahead queue, a ring buffer protected by CACHE_LOCK. */
+static block_sector_t ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head, ra_cnt;
+static struct condition ra_wait;    /* Signaled when a request is queued. */
+
+/* Statistics. */
+static unsigned long long hit_cnt, miss_cnt, write_back_cnt;
+static unsigned long long ra_read_cnt, ra_drop_cnt;
+static unsigned long long flush_cnt, throttle_cnt;
+
+static thread_func readahead_thread NO_RETURN;
+static thread_func flusher_thread NO_RETURN;
+static struct cache_entry *get_entry (block_sector_t, bool load, bool *hit);
+static struct cache_entry *lookup (block_sector_t);
+static struct cache_entry *find_victim (void);
+static void mark_dirty (struct cache_entry *);
+static size_t flush_dirty (int64_t oldest);
+static int compare_sectors (const void *, const void *);
+static void write_back (struct cache_entry *);
+static void write_back_batch (struct cache_entry *[], size_t cnt);
+
+/* Sets the write-behind parameters from SPEC, which has the form
+   "MSEC,CNT": sectors are written back once they have been dirty
+   for MSEC milliseconds, and writers are throttled when more
+   than CNT sectors are dirty.  Returns false if SPEC is
+   malformed.  Must be called before cache_init(). */
+bool
+cache_set_writeback (const char *spec)
+{
+  const char *comma;
+  int msec, cnt;
+
+  if (spec == NULL || (comma = strchr (spec, ',')) == NULL)
+    return false;
+  msec = atoi (spec);
+  cnt = atoi (comma + 1);
+  if (msec <= 0 || cnt <= 0 || cnt > CACHE_SECTORS)
+    return false;
+
+  flush_age = (int64_t) msec * TIMER_FREQ / 1000;
+  if (flush_age < 2)
+    flush_age = 2;
+  dirty_limit = cnt;
+  return true;
+}
+
+/* Initializes the buffer cache and starts the read-ahead and
+   flusher threads. */
+void
+cache_init (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (CACHE_SECTORS * BLOCK_SECTOR_SIZE, PGSIZE);
+  uint8_t *data = palloc_get_multiple (PAL_ASSERT, page_cnt);
+  size_t i;
+
+  lock_init (&cache_lock);
+  cond_init (&io_done);
+  cond_init (&ra_wait);
+  for (i = 0; i < CACHE_SECTORS; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      e->sector = CACHE_EMPTY;
+      e->dirty = e->accessed = e->busy = false;
+      e->data = data + i * BLOCK_SECTOR_SIZE;
+    }
+
+  if (thread_create ("readahead", PRI_DEFAULT, readahead_thread, NULL)
+      == TID_ERROR)
+    PANIC ("Failed to create read-ahead thread!");
+  if (thread_create ("flusher", PRI_DEFAULT, flusher_thread, NULL)
+      == TID_ERROR)
+    PANIC ("Failed to create flusher thread!");
+}
+
+/* Copies SIZE bytes starting at byte SECTOR_OFS of SECTOR on the
+   file system device into BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, int sector_ofs, int size)
+{
+  struct cache_entry *e;
+  bool hit;
+
+  ASSERT (sector_ofs >= 0 && size >= 0
+          && sector_ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, true, &hit);
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+  memcpy (buffer, e->data + sector_ofs, size);
+  lock_release (&cache_lock);
+}
+
+/* Copies SIZE bytes from BUFFER to byte SECTOR_OFS of SECTOR on
+   the file system device.  The sector reaches the disk when it
+   is evicted or flushed, or when it has been dirty for the
+   flush age.  If that leaves too many sectors dirty, writes them
+   all back before returning. */
+void
+cache_write (block_sector_t sector, const void *buffer, int sector_ofs,
+             int size)
+{
+  struct cache_entry *e;
+  bool hit;
+
+  ASSERT (sector_ofs >= 0 && size >= 0
+          && sector_ofs + size <= BLOCK_SECTOR_SIZE);
+
+  /* A write of the whole sector need not read it first. */
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, size < BLOCK_SECTOR_SIZE, &hit);
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+  memcpy (e->data + sector_ofs, buffer, size);
+  mark_dirty (e);
+  if (dirty_cnt > dirty_limit)
+    {
+      throttle_cnt++;
+      flush_dirty (INT64_MAX);
+    }
+  lock_release (&cache_lock);
+}
+
+/* Asks the read-ahead thread to read SECTOR into the cache in
+   the background.  Returns without waiting. */
+void
+cache_readahead (block_sector_t sector)
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  if (lookup (sector) != NULL)
+    goto done;
+  for (i = 0; i < ra_cnt; i++)
+    if (ra_queue[(ra_head + i) % RA_QUEUE_SIZE] == sector)
+      goto done;
+  if (ra_cnt == RA_QUEUE_SIZE)
+    {
+      ra_drop_cnt++;
+      goto done;
+    }
+  ra_queue[(ra_head + ra_cnt++) % RA_QUEUE_SIZE] = sector;
+  cond_signal (&ra_wait, &cache_lock);
+
+ done:
+  lock_release (&cache_lock);
+}
+
+/* Writes every dirty sector in the cache to disk, and waits for
+   write-backs already in progress to finish. */
+void
+cache_flush (void)
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  for (i = 0; i < CACHE_SECTORS; i++)
+    while (cache[i].busy)
+      cond_wait (&io_done, &cache_lock);
+  flush_dirty (INT64_MAX);
+  lock_release (&cache_lock);
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  printf ("Cache: %llu hits, %llu misses, %llu write-backs\n",
+          hit_cnt, miss_cnt, write_back_cnt);
+  printf ("Cache: %llu sectors read ahead, %llu requests dropped\n",
+          ra_read_cnt, ra_drop_cnt);
+  printf ("Cache: %llu sectors flushed by age, %llu writers throttled\n",
+          flush_cnt, throttle_cnt);
+}
+
+/* Read-ahead thread: reads queued sectors into the cache. */
+static void
+readahead_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      block_sector_t sector;
+      bool hit;
+
+      lock_acquire (&cache_lock);
+      while (ra_cnt == 0)
+        cond_wait (&ra_wait, &cache_lock);
+      sector = ra_queue[ra_head];
+      ra_head = (ra_head + 1) % RA_QUEUE_SIZE;
+      ra_cnt--;
+
+      get_entry (sector, true, &hit);
+      if (!hit)
+        ra_read_cnt++;
+      lock_release (&cache_lock);
+    }
+}
+
+/* Flusher thread: periodically writes back sectors that have
+   been dirty for at least FLUSH_AGE ticks. */
+static void
+flusher_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (flush_age / 2);
+
+      lock_acquire (&cache_lock);
+      flush_cnt += flush_dirty (timer_ticks () - flush_age);
+      lock_release (&cache_lock);
+    }
+}
+
+/* Returns the entry that caches SECTOR, loading SECTOR into an
+   entry if it is not cached, and sets *HIT to whether it was.
+   If LOAD is false, the caller will overwrite the whole sector,
+   so a newly cached sector is not read from disk.  The returned
+   entry is not busy and stays valid as long as the caller holds
+   the cache lock, which must be held on entry. */
+static struct cache_entry *
+get_entry (block_sector_t sector, bool load, bool *hit)
+{
+  struct cache_entry *e;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (;;)
+    {
+      e = lookup (sector);
+      if (e != NULL)
+        {
+          if (!e->busy)
+            {
+              *hit = true;
+              e->accessed = true;
+              return e;
+            }
+          cond_wait (&io_done, &cache_lock);
+          continue;
+        }
+
+      e = find_victim ();
+      if (e == NULL)
+        {
+          /* Every entry is busy. */
+          cond_wait (&io_done, &cache_lock);
+          continue;
+        }
+      if (e->dirty)
+        {
+          /* SECTOR may be cached by someone else while the lock
+             is released, so look it up again afterward. */
+          write_back (e);
+          continue;
+        }
+      break;
+    }
+
+  *hit = false;
+  e->sector = sector;
+  e->accessed = true;
+  if (load)
+    {
+      e->busy = true;
+      lock_release (&cache_lock);
+      block_read (fs_device, sector, e->data);
+      lock_acquire (&cache_lock);
+      e->busy = false;
+      cond_broadcast (&io_done, &cache_lock);
+    }
+  return e;
+}
+
+/* Returns the entry that caches SECTOR, or a null pointer if
+   SECTOR is not cached. */
+static struct cache_entry *
+lookup (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SECTORS; i++)
+    if (cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an entry to replace with the clock algorithm and
+   returns it, or a null pointer if every entry is busy.  An
+   empty entry is taken as soon as the hand reaches it. */
+static struct cache_entry *
+find_victim (void)
+{
+  size_t i;
+
+  for (i = 0; i < 2 * CACHE_SECTORS; i++)
+    {
+      struct cache_entry *e = &cache[hand];
+
+      hand = (hand + 1) % CACHE_SECTORS;
+      if (e->busy)
+        continue;
+      if (e->sector == CACHE_EMPTY || !e->accessed)
+        return e;
+      e->accessed = false;
+    }
+  return NULL;
+}
+
+/* Marks entry E dirty, noting when it became so. */
+static void
+mark_dirty (struct cache_entry *e)
+{
+  if (!e->dirty)
+    {
+      e->dirty = true;
+      e->dirty_since = timer_ticks ();
+      dirty_cnt++;
+    }
+}
+
+/* Writes back every entry that has been dirty since tick OLDEST
+   or earlier, in ascending sector order, and returns the number
+   of entries written.  The cache lock must be held; it is
+   released during the writes. */
+static size_t
+flush_dirty (int64_t oldest)
+{
+  struct cache_entry *batch[CACHE_SECTORS];
+  size_t cnt = 0;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < CACHE_SECTORS; i++)
+    if (cache[i].dirty && cache[i].dirty_since <= oldest)
+      batch[cnt++] = &cache[i];
+  if (cnt > 0)
+    {
+      qsort (batch, cnt, sizeof *batch, compare_sectors);
+      write_back_batch (batch, cnt);
+    }
+  return cnt;
+}
+
+/* qsort() comparison function that orders pointers to cache
+   entries by sector. */
+static int
+compare_sectors (const void *a_, const void *b_)
+{
+  const struct cache_entry *a = *(struct cache_entry *const *) a_;
+  const struct cache_entry *b = *(struct cache_entry *const *) b_;
+
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Writes dirty entry E back to disk, releasing the cache lock
+   during the write.  E is busy meanwhile, so its contents cannot
+   change. */
+static void
+write_back (struct cache_entry *e)
+{
+  write_back_batch (&e, 1);
+}
+
+/* Writes the CNT dirty entries in BATCH back to disk in order,
+   releasing the cache lock during the writes.  The entries are
+   busy meanwhile, so their contents cannot change. */
+static void
+write_back_batch (struct cache_entry *batch[], size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct cache_entry *e = batch[i];
+
+      ASSERT (e->dirty && !e->busy);
+      e->busy = true;
+      e->dirty = false;
+      dirty_cnt--;
+      write_back_cnt++;
+    }
+  lock_release (&cache_lock);
+  for (i = 0; i < cnt; i++)
+    block_write (fs_device, batch[i]->sector, batch[i]->data);
+  lock_acquire (&cache_lock);
+  for (i = 0; i < cnt; i++)
+    batch[i]->busy = false;
+  cond_broadcast (&io_done, &cache_lock);
+}
@@ -0,0 +1,18 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Buffer cache of file system sectors.  See cache.c. */
+
+bool cache_set_writeback (const char *spec);
+void cache_init (void);
+void cache_read (block_sector_t, void *buffer, int sector_ofs, int size);
+void cache_write (block_sector_t, const void *buffer, int sector_ofs,
+                  int size);
+void cache_readahead (block_sector_t);
+void cache_flush (void);
+void cache_print_stats (void);
+
+#endif /* filesys/cache.h */
@@ -1,7 +1,12 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "devices/block.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+
+/* Read-ahead window bounds, in sectors. */
+#define READAHEAD_MIN 4
+#define READAHEAD_MAX 16
 
 /* An open file. */
 struct file
@@ -9,25 +14,42 @@ struct file
   struct inode *inode; /* File's inode. */
   off_t pos;           /* Current position. */
   bool deny_write;     /* Has file_deny_write() been called? */
+  off_t ra_next;       /* Position where a sequential read continues. */
+  off_t ra_end;        /* End of the data already read ahead. */
+  int ra_window;       /* Read-ahead window in sectors, 0 if random. */
 };
 
+static void readahead(struct file *file, off_t pos, off_t size);
+
+/* Cache of open files. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the open file cache. */
+void file_init(void)
+{
+  file_cache = kmem_cache_create("file", sizeof(struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *file_open(struct inode *inode)
 {
-  struct file *file = calloc(1, sizeof *file);
+  struct file *file = kmem_cache_zalloc(file_cache);
   if (inode != NULL && file != NULL)
   {
     file->inode = inode;
     file->pos = 0;
     file->deny_write = false;
+    file->ra_next = 0;
+    file->ra_end = 0;
+    file->ra_window = 0;
     return file;
   }
   else
   {
     inode_close(inode);
-    free(file);
+    kmem_cache_free(file_cache, file);
     return NULL;
   }
 }
@@ -46,7 +68,7 @@ void file_close(struct file *file)
   {
     file_allow_write(file);
     inode_close(file->inode);
-    free(file);
+    kmem_cache_free(file_cache, file);
   }
 }
 
@@ -65,11 +87,17 @@ struct inode *file_get_inode(struct file *file)
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If the read continues where the previous one ended, starts
+   reading the data after it in the background. */
 off_t file_read(struct file *file, void *buffer, off_t size)
 {
-  off_t bytes_read = inode_read_at(file->inode, buffer, size, file->pos);
+  off_t bytes_read;
+
+  readahead(file, file->pos, size);
+  bytes_read = inode_read_at(file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
+  file->ra_next = file->pos;
   return bytes_read;
 }
 
@@ -158,3 +186,36 @@ off_t file_tell(struct file *file)
   ASSERT(file != NULL);
   return file->pos;
 }
+
+/* Sequential read-ahead for a read of SIZE bytes of FILE at POS.
+   A read that starts where the previous one ended doubles FILE's
+   read-ahead window, up to READAHEAD_MAX sectors, and queues the
+   part of the window after the read that has not been requested
+   yet, so that it is fetched while the caller copies this read.
+   Any other read closes the window. */
+static void readahead(struct file *file, off_t pos, off_t size)
+{
+  off_t start, end;
+
+  if (pos != file->ra_next)
+  {
+    file->ra_window = 0;
+    file->ra_end = 0;
+    return;
+  }
+
+  if (file->ra_window == 0)
+    file->ra_window = READAHEAD_MIN;
+  else if (file->ra_window < READAHEAD_MAX)
+    file->ra_window *= 2;
+
+  start = pos + size;
+  if (start < file->ra_end)
+    start = file->ra_end;
+  end = pos + size + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (start < end)
+  {
+    inode_readahead(file->inode, end - start, start);
+    file->ra_end = end;
+  }
+}
@@ -7,6 +7,7 @@
 struct inode;
 
 /* Opening and closing files. */
+void file_init(void);
 struct file *file_open(struct inode *);
 struct file *file_reopen(struct file *);
 void file_close(struct file *);
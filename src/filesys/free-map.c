@@ -39,6 +39,31 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates up to CNT consecutive sectors starting at SECTOR,
+   stopping at the first one that is in use or past the end of
+   the device.
+   Returns the number of sectors allocated, which is 0 if SECTOR
+   is not free or if the free_map file could not be written. */
+size_t
+free_map_extend (block_sector_t sector, size_t cnt)
+{
+  size_t free_cnt = 0;
+
+  while (free_cnt < cnt && sector + free_cnt < bitmap_size (free_map)
+         && !bitmap_test (free_map, sector + free_cnt))
+    free_cnt++;
+  if (free_cnt == 0)
+    return 0;
+
+  bitmap_set_multiple (free_map, sector, free_cnt, true);
+  if (free_map_file != NULL && !bitmap_write (free_map, free_map_file))
+    {
+      bitmap_set_multiple (free_map, sector, free_cnt, false);
+      return 0;
+    }
+  return free_cnt;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
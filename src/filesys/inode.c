@@ -1,23 +1,61 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* A file's data is stored in extents, runs of consecutive
+   sectors.  The first DIRECT_EXTENTS extents are listed in the
+   inode itself and the rest in a single indirect block.  A file
+   grows by extending its last extent in place when the sectors
+   after it are free, and otherwise by starting a new extent, so
+   that a file's data stays in a few long runs that can be read
+   sequentially. */
+
+/* A run of consecutive sectors. */
+struct extent
+  {
+    block_sector_t start;               /* First sector. */
+    uint32_t length;                    /* Number of sectors. */
+  };
+
+/* Number of extents listed in the inode. */
+#define DIRECT_EXTENTS 61
+
+/* Number of extents listed in the indirect block. */
+#define INDIRECT_EXTENTS (BLOCK_SECTOR_SIZE / sizeof (struct extent))
+
+/* Maximum number of extents in a file. */
+#define MAX_EXTENTS (DIRECT_EXTENTS + INDIRECT_EXTENTS)
+
+/* Maximum number of sectors, beyond those asked for, allocated
+   when a file starts a new extent.  See grow(). */
+#define MAX_PREALLOC 64
+
+/* INDIRECT value of an inode without an indirect block. */
+#define NO_SECTOR ((block_sector_t) -1)
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t sector_cnt;                /* Sectors in all extents. */
+    uint32_t extent_cnt;                /* Number of extents. */
+    block_sector_t indirect;            /* Indirect block or NO_SECTOR. */
+    struct extent extents[DIRECT_EXTENTS]; /* First extents. */
+    uint32_t unused[1];                 /* Not used. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -31,14 +69,27 @@ bytes_to_sectors (off_t size)
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem hash_elem;         /* Element in inode table. */
+    struct list_elem lru_elem;          /* Element in closed-inode LRU. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    struct extent *indirect;            /* Indirect block content, if any. */
   };
 
+static unsigned inode_hash (const struct hash_elem *, void *aux);
+static bool inode_less (const struct hash_elem *, const struct hash_elem *,
+                        void *aux);
+static void free_inode (struct inode *);
+static struct extent *get_extent (const struct inode *, size_t idx);
+static bool grow (struct inode *, off_t length);
+static size_t allocate_run (size_t cnt, block_sector_t *);
+static void write_inode (struct inode *);
+static void release_sectors (struct inode *);
+static void trim (struct inode *);
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -46,21 +97,56 @@ struct inode
 static block_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) 
 {
+  size_t sector_idx;
+  size_t i;
+
   ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
+  if (pos >= inode->data.length)
     return -1;
+
+  sector_idx = pos / BLOCK_SECTOR_SIZE;
+  for (i = 0; i < inode->data.extent_cnt; i++)
+    {
+      const struct extent *e = get_extent (inode, i);
+      if (sector_idx < e->length)
+        return e->start + sector_idx;
+      sector_idx -= e->length;
+    }
+  NOT_REACHED ();
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Table of in-memory inodes, keyed by sector, so that opening a
+   single inode twice returns the same `struct inode'.
+
+   An inode whose last opener closes it stays in the table, on
+   the CLOSED_INODES list, so that reopening it, as opening a
+   file again or looking up a name in a directory in a path does,
+   does not have to read it from disk.  When more than
+   CLOSED_INODES_MAX inodes are closed, the least recently closed
+   one is freed.  A removed inode is freed as soon as it is
+   closed. */
+static struct hash inodes;
+
+/* Closed inodes, most recently closed first. */
+static struct list closed_inodes;
+static size_t closed_cnt;
+
+/* Maximum number of closed inodes kept in memory. */
+#define CLOSED_INODES_MAX 32
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache *inode_cache;
+
+/* Statistics. */
+static unsigned long long lookup_cnt, reuse_cnt, disk_read_cnt;
 
 /* Initializes the inode module. */
 void inode_init (void) 
 {
-  list_init (&open_inodes);
+  if (!hash_init (&inodes, inode_hash, inode_less, NULL))
+    PANIC ("can't create inode table");
+  list_init (&closed_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -71,36 +157,29 @@ void inode_init (void)
 bool
 inode_create (block_sector_t sector, off_t length)
 {
-  struct inode_disk *disk_inode = NULL;
-  bool success = false;
+  struct inode *inode;
+  bool success;
 
   ASSERT (length >= 0);
 
   /* If this assertion fails, the inode structure is not exactly
      one sector in size, and you should fix that. */
-  ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof inode->data == BLOCK_SECTOR_SIZE);
 
-  disk_inode = calloc (1, sizeof *disk_inode);
-  if (disk_inode != NULL)
-    {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
-      free (disk_inode);
-    }
+  inode = kmem_cache_zalloc (inode_cache);
+  if (inode == NULL)
+    return false;
+
+  inode->sector = sector;
+  inode->data.magic = INODE_MAGIC;
+  inode->data.indirect = NO_SECTOR;
+  success = grow (inode, length);
+  if (success)
+    write_inode (inode);
+  else
+    release_sectors (inode);
+  free (inode->indirect);
+  kmem_cache_free (inode_cache, inode);
   return success;
 }
 
@@ -110,33 +189,51 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
 
-  /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  /* Check whether this inode is already in memory. */
+  lookup_cnt++;
+  key.sector = sector;
+  e = hash_find (&inodes, &key.hash_elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
+      inode = hash_entry (e, struct inode, hash_elem);
+      if (inode->open_cnt == 0)
         {
-          inode_reopen (inode);
-          return inode; 
+          list_remove (&inode->lru_elem);
+          closed_cnt--;
+          reuse_cnt++;
         }
+      return inode_reopen (inode);
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  disk_read_cnt++;
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->indirect = NULL;
+  cache_read (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  if (inode->data.indirect != NO_SECTOR)
+    {
+      inode->indirect = malloc (BLOCK_SECTOR_SIZE);
+      if (inode->indirect == NULL)
+        {
+          kmem_cache_free (inode_cache, inode);
+          return NULL;
+        }
+      cache_read (inode->data.indirect, inode->indirect, 0,
+                  BLOCK_SECTOR_SIZE);
+    }
+  hash_insert (&inodes, &inode->hash_elem);
   return inode;
 }
 
@@ -157,8 +254,13 @@ inode_get_inumber (const struct inode *inode)
 }
 
 /* Closes INODE and writes it to disk.
-   If this was the last reference to INODE, frees its memory.
-   If INODE was also a removed inode, frees its blocks. */
+   If this was the last reference to INODE, releases the sectors
+   that grow() preallocated but the file did not grow into, and
+   keeps INODE in memory for reuse by inode_open(), freeing the
+   memory of the least recently closed inode if too many are
+   kept.
+   If INODE was also a removed inode, frees its memory and its
+   blocks. */
 void
 inode_close (struct inode *inode) 
 {
@@ -169,18 +271,24 @@ inode_close (struct inode *inode)
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          release_sectors (inode);
+          free_inode (inode);
+          return;
         }
 
-      free (inode); 
+      /* Keep the inode for reuse. */
+      trim (inode);
+      list_push_front (&closed_inodes, &inode->lru_elem);
+      if (++closed_cnt > CLOSED_INODES_MAX)
+        {
+          struct list_elem *e = list_pop_back (&closed_inodes);
+          closed_cnt--;
+          free_inode (list_entry (e, struct inode, lru_elem));
+        }
     }
 }
 
@@ -201,7 +309,6 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0) 
     {
@@ -219,51 +326,40 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      /* Copy the chunk out of the buffer cache. */
+      cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+   A write past end of file extends the inode, filling any gap
+   with zeros.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  /* Extend the inode, as far as disk space allows. */
+  if (size > 0 && offset + size > inode->data.length)
+    {
+      grow (inode, offset + size);
+      write_inode (inode);
+    }
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -280,42 +376,39 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* Copy the chunk into the buffer cache, which reads in
+         the rest of the sector first if the chunk does not cover
+         all of it. */
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                   chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
   return bytes_written;
 }
 
+/* Starts reading the sectors that hold the SIZE bytes of INODE
+   starting at OFFSET into the buffer cache in the background,
+   stopping at end of file. */
+void
+inode_readahead (struct inode *inode, off_t size, off_t offset) 
+{
+  off_t end = offset + size;
+
+  for (offset -= offset % BLOCK_SECTOR_SIZE; offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      if (sector_idx == (block_sector_t) -1)
+        break;
+      cache_readahead (sector_idx);
+    }
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -342,3 +435,210 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Prints inode statistics. */
+void
+inode_print_stats (void)
+{
+  printf ("Inodes: %llu opens, %llu reused after close, %llu read\n",
+          lookup_cnt, reuse_cnt, disk_read_cnt);
+}
+
+/* Returns a hash value for the inode that contains E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct inode *inode = hash_entry (e, struct inode, hash_elem);
+  return hash_int (inode->sector);
+}
+
+/* Returns true if the inode that contains A has a lower sector
+   than the one that contains B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode, hash_elem)->sector
+          < hash_entry (b, struct inode, hash_elem)->sector);
+}
+
+/* Removes INODE, which must not be open, from the inode table
+   and frees it. */
+static void
+free_inode (struct inode *inode)
+{
+  ASSERT (inode->open_cnt == 0);
+
+  hash_delete (&inodes, &inode->hash_elem);
+  free (inode->indirect);
+  kmem_cache_free (inode_cache, inode);
+}
+
+/* Returns a pointer to extent IDX of INODE, which must be less
+   than MAX_EXTENTS. */
+static struct extent *
+get_extent (const struct inode *inode, size_t idx)
+{
+  ASSERT (idx < MAX_EXTENTS);
+  if (idx < DIRECT_EXTENTS)
+    return (struct extent *) &inode->data.extents[idx];
+  ASSERT (inode->indirect != NULL);
+  return &inode->indirect[idx - DIRECT_EXTENTS];
+}
+
+/* Extends INODE to LENGTH bytes, allocating and zeroing sectors
+   as needed.  Does not write the inode to disk.  Returns true if
+   successful, false if the disk or the extent list filled up, in
+   which case INODE is extended as far as its sectors allow.
+
+   Sectors directly after the last extent are added to it.  When
+   they are in use, a new extent is started elsewhere, and to
+   keep files that grow a little at a time from ending up with
+   one extent per write, the new extent gets room for the file to
+   grow into as well: up to as many sectors again as the file
+   already has, but not more than MAX_PREALLOC.  Room that is
+   still unused when the file's last opener closes it is
+   released by trim(). */
+static bool
+grow (struct inode *inode, off_t length)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  struct inode_disk *data = &inode->data;
+  size_t need = bytes_to_sectors (length);
+  bool success = true;
+
+  while (data->sector_cnt < need)
+    {
+      size_t cnt = need - data->sector_cnt;
+      struct extent *last = NULL;
+      block_sector_t start;
+      size_t got = 0;
+      size_t i;
+
+      if (data->extent_cnt > 0)
+        {
+          last = get_extent (inode, data->extent_cnt - 1);
+          got = free_map_extend (last->start + last->length, cnt);
+        }
+      if (got > 0)
+        {
+          start = last->start + last->length;
+          last->length += got;
+        }
+      else
+        {
+          size_t prealloc = data->sector_cnt < MAX_PREALLOC
+                            ? data->sector_cnt : MAX_PREALLOC;
+          struct extent *e;
+
+          if (data->extent_cnt == MAX_EXTENTS)
+            {
+              success = false;
+              break;
+            }
+          if (data->extent_cnt == DIRECT_EXTENTS && inode->indirect == NULL)
+            {
+              inode->indirect = calloc (1, BLOCK_SECTOR_SIZE);
+              if (inode->indirect == NULL)
+                {
+                  success = false;
+                  break;
+                }
+              if (!free_map_allocate (1, &data->indirect))
+                {
+                  free (inode->indirect);
+                  inode->indirect = NULL;
+                  success = false;
+                  break;
+                }
+            }
+          got = allocate_run (cnt + prealloc, &start);
+          if (got == 0)
+            {
+              success = false;
+              break;
+            }
+          e = get_extent (inode, data->extent_cnt++);
+          e->start = start;
+          e->length = got;
+        }
+
+      for (i = 0; i < got; i++)
+        cache_write (start + i, zeros, 0, BLOCK_SECTOR_SIZE);
+      data->sector_cnt += got;
+    }
+
+  if (!success && (off_t) data->sector_cnt * BLOCK_SECTOR_SIZE < length)
+    length = data->sector_cnt * BLOCK_SECTOR_SIZE;
+  if (length > data->length)
+    data->length = length;
+  return success;
+}
+
+/* Allocates a run of up to CNT consecutive sectors, trying
+   shorter runs when no run of CNT sectors is free, and stores
+   the first sector of the run in *START.  Returns the number of
+   sectors allocated, which is 0 if the disk is full. */
+static size_t
+allocate_run (size_t cnt, block_sector_t *start)
+{
+  for (; cnt > 0; cnt /= 2)
+    if (free_map_allocate (cnt, start))
+      return cnt;
+  return 0;
+}
+
+/* Writes INODE's on-disk inode and its indirect block, if any,
+   to disk. */
+static void
+write_inode (struct inode *inode)
+{
+  cache_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  if (inode->indirect != NULL)
+    cache_write (inode->data.indirect, inode->indirect, 0,
+                 BLOCK_SECTOR_SIZE);
+}
+
+/* Releases INODE's data sectors and indirect block, but not the
+   sector of the inode itself. */
+static void
+release_sectors (struct inode *inode)
+{
+  size_t i;
+
+  for (i = 0; i < inode->data.extent_cnt; i++)
+    {
+      struct extent *e = get_extent (inode, i);
+      free_map_release (e->start, e->length);
+    }
+  if (inode->data.indirect != NO_SECTOR)
+    free_map_release (inode->data.indirect, 1);
+}
+
+/* Releases the sectors at the end of INODE beyond those its
+   length needs, which grow() preallocated, and writes INODE to
+   disk if any were released. */
+static void
+trim (struct inode *inode)
+{
+  struct inode_disk *data = &inode->data;
+  size_t need = bytes_to_sectors (data->length);
+
+  if (data->sector_cnt <= need)
+    return;
+
+  while (data->sector_cnt > need)
+    {
+      struct extent *last = get_extent (inode, data->extent_cnt - 1);
+      size_t cnt = data->sector_cnt - need;
+
+      if (cnt > last->length)
+        cnt = last->length;
+      free_map_release (last->start + last->length - cnt, cnt);
+      last->length -= cnt;
+      data->sector_cnt -= cnt;
+      if (last->length == 0)
+        data->extent_cnt--;
+    }
+  write_inode (inode);
+}
@@ -69,6 +69,116 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a bit mask in which the bits of element ELEM_IDX(START)
+   numbered START and above are set to 1 and the rest are set to 0. */
+static inline elem_type
+head_mask (size_t start)
+{
+  return (elem_type) -1 << (start % ELEM_BITS);
+}
+
+/* Returns a bit mask in which the bits of element ELEM_IDX(END - 1)
+   numbered below END are set to 1 and the rest are set to 0. */
+static inline elem_type
+tail_mask (size_t end)
+{
+  int tail_bits = end % ELEM_BITS;
+  return tail_bits ? ((elem_type) 1 << tail_bits) - 1 : (elem_type) -1;
+}
+
+/* Returns element IDX of B with the bits that are set to VALUE
+   turned on and all others turned off. */
+static inline elem_type
+elem_match (const struct bitmap *b, size_t idx, bool value)
+{
+  return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns the index of the lowest 1 bit in W, which must not be
+   zero.  See the description of the BSF instruction in
+   [IA32-v2a]. */
+static inline size_t
+bit_scan_forward (elem_type w)
+{
+  elem_type idx;
+  asm ("bsfl %1, %0" : "=r" (idx) : "rm" (w) : "cc");
+  return idx;
+}
+
+/* Returns the index of the highest 1 bit in W, which must not be
+   zero.  See the description of the BSR instruction in
+   [IA32-v2a]. */
+static inline size_t
+bit_scan_reverse (elem_type w)
+{
+  elem_type idx;
+  asm ("bsrl %1, %0" : "=r" (idx) : "rm" (w) : "cc");
+  return idx;
+}
+
+/* Returns the number of 1 bits in W. */
+static inline size_t
+popcount (elem_type w)
+{
+  w = w - ((w >> 1) & 0x55555555);
+  w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+  w = (w + (w >> 4)) & 0x0f0f0f0f;
+  return (w * 0x01010101) >> 24;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Elements that contain no such bit are skipped with a single
+   comparison. */
+static size_t
+find_first (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, last;
+  elem_type w;
+
+  if (start >= end)
+    return end;
+  idx = elem_idx (start);
+  last = elem_idx (end - 1);
+  w = elem_match (b, idx, value) & head_mask (start);
+  for (;;)
+    {
+      if (idx == last)
+        w &= tail_mask (end);
+      if (w != 0)
+        return idx * ELEM_BITS + bit_scan_forward (w);
+      if (idx == last)
+        return end;
+      w = elem_match (b, ++idx, value);
+    }
+}
+
+/* Returns the index of the last bit in B between START and END,
+   exclusive, that is set to VALUE, or BITMAP_ERROR if there is
+   none. */
+static size_t
+find_last (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, first;
+  elem_type w;
+
+  if (start >= end)
+    return BITMAP_ERROR;
+  idx = elem_idx (end - 1);
+  first = elem_idx (start);
+  w = elem_match (b, idx, value) & tail_mask (end);
+  for (;;)
+    {
+      if (idx == first)
+        w &= head_mask (start);
+      if (w != 0)
+        return idx * ELEM_BITS + bit_scan_reverse (w);
+      if (idx == first)
+        return BITMAP_ERROR;
+      w = elem_match (b, --idx, value);
+    }
+}
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -208,33 +318,62 @@ void bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, one element at a time. */
 void bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t idx, last, end;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+  end = start + cnt;
+  last = elem_idx (end - 1);
+  for (idx = elem_idx (start); idx <= last; idx++)
+    {
+      elem_type mask = (elem_type) -1;
+
+      if (idx == elem_idx (start))
+        mask &= head_mask (start);
+      if (idx == last)
+        mask &= tail_mask (end);
+
+      /* See bitmap_mark() and bitmap_reset(). */
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t idx, last, end, value_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
+  if (cnt == 0)
+    return 0;
+  end = start + cnt;
+  last = elem_idx (end - 1);
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  for (idx = elem_idx (start); idx <= last; idx++)
+    {
+      elem_type w = elem_match (b, idx, value);
+
+      if (idx == elem_idx (start))
+        w &= head_mask (start);
+      if (idx == last)
+        w &= tail_mask (end);
+      value_cnt += popcount (w);
+    }
   return value_cnt;
 }
 
@@ -242,16 +381,11 @@ size_t bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool valu
    exclusive, are set to VALUE, and false otherwise. */
 bool bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_first (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -280,19 +414,36 @@ bool bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Works a word at a time: the next candidate start is the first
+   bit set to VALUE (found with BSF, skipping whole words of
+   !VALUE bits), and if the CNT-bit window there contains a !VALUE
+   bit, the search resumes just past the last such bit (found
+   with BSR), since no window that contains it can succeed. */
 size_t bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+
+      while (start <= last)
+        {
+          size_t conflict;
+
+          start = find_first (b, start, b->bit_cnt, value);
+          if (start > last)
+            break;
+          conflict = find_last (b, start, start + cnt, !value);
+          if (conflict == BITMAP_ERROR)
+            return start;
+          start = conflict + 1;
+        }
     }
   return BITMAP_ERROR;
 }
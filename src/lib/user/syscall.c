@@ -142,3 +142,11 @@ bool isdir (int fd) {
 int inumber (int fd) {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t fork (void) {
+  return syscall0 (SYS_FORK);
+}
+
+void sync (void) {
+  syscall0 (SYS_SYNC);
+}
@@ -0,0 +1,50 @@
+/* Fills the file system with small files and removes every
+   other one, so that no free run of sectors is longer than a
+   small file, then creates a large file in the holes and
+   verifies that it reads back properly. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_SIZE 8192
+#define MAX_FILES 1000
+
+static char buf[128 * 1024];
+
+void
+test_main (void)
+{
+  char file_name[16];
+  int file_cnt, i, fd;
+
+  msg ("fill the file system");
+  for (file_cnt = 0; file_cnt < MAX_FILES; file_cnt++)
+    {
+      snprintf (file_name, sizeof file_name, "small%d", file_cnt);
+      if (!create (file_name, SMALL_SIZE))
+        break;
+    }
+  if (file_cnt < 16)
+    fail ("only %d small files could be created", file_cnt);
+
+  msg ("remove every other file");
+  for (i = 0; i < file_cnt; i += 2)
+    {
+      snprintf (file_name, sizeof file_name, "small%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+    }
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("large", 0), "create \"large\"");
+  CHECK ((fd = open ("large")) > 1, "open \"large\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %zu bytes to \"large\"", sizeof buf);
+  msg ("close \"large\"");
+  close (fd);
+
+  check_file ("large", buf, sizeof buf);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-fragment) begin
+(grow-fragment) fill the file system
+(grow-fragment) remove every other file
+(grow-fragment) create "large"
+(grow-fragment) open "large"
+(grow-fragment) write 131072 bytes to "large"
+(grow-fragment) close "large"
+(grow-fragment) open "large" for verification
+(grow-fragment) verified contents of "large"
+(grow-fragment) close "large"
+(grow-fragment) end
+EOF
+pass;
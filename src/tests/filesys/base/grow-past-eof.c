@@ -0,0 +1,38 @@
+/* Writes to a file at an offset past its end and verifies that
+   the file grows to cover the write and that the gap between the
+   old end of file and the write reads back as zeros. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAD_SIZE 100
+#define GAP_OFS 5000
+#define TAIL_SIZE 1234
+
+static char expected[GAP_OFS + TAIL_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "sparse";
+  int fd;
+
+  random_bytes (expected, HEAD_SIZE);
+  random_bytes (expected + GAP_OFS, TAIL_SIZE);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, expected, HEAD_SIZE) == HEAD_SIZE,
+         "write %d bytes to \"%s\"", HEAD_SIZE, file_name);
+  msg ("seek \"%s\" to %d", file_name, GAP_OFS);
+  seek (fd, GAP_OFS);
+  CHECK (write (fd, expected + GAP_OFS, TAIL_SIZE) == TAIL_SIZE,
+         "write %d bytes to \"%s\"", TAIL_SIZE, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, expected, sizeof expected);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-past-eof) begin
+(grow-past-eof) create "sparse"
+(grow-past-eof) open "sparse"
+(grow-past-eof) write 100 bytes to "sparse"
+(grow-past-eof) seek "sparse" to 5000
+(grow-past-eof) write 1234 bytes to "sparse"
+(grow-past-eof) close "sparse"
+(grow-past-eof) open "sparse" for verification
+(grow-past-eof) verified contents of "sparse"
+(grow-past-eof) close "sparse"
+(grow-past-eof) end
+EOF
+pass;
@@ -0,0 +1,108 @@
+/* Test and microbenchmark for bitmap_scan() in lib/kernel/bitmap.c.
+
+   Fills large bitmaps to various densities with randomly placed
+   set bits, then searches them for runs of free bits of various
+   lengths, both with bitmap_scan() and with the original
+   bit-at-a-time algorithm.  Verifies that both find the same runs
+   and reports the timer ticks each one took.
+
+   Build it into the kernel with "make INTERNAL_TEST=bitmap" and
+   run it with "pintos -- internal".
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of bits in each bitmap: a 4 GB pool of 4 kB pages. */
+#define BIT_CNT (1024 * 1024)
+
+/* Number of scans timed for each configuration. */
+#define SCAN_CNT 64
+
+static size_t scan_naive (const struct bitmap *, size_t start, size_t cnt,
+                          bool value);
+static void benchmark (struct bitmap *, int used_pct, size_t cnt);
+
+/* Benchmark bitmap_scan() against the bit-at-a-time search. */
+void
+test (void)
+{
+  static const int used_pcts[] = {50, 90, 99};
+  static const size_t cnts[] = {1, 8, 64};
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i, j;
+
+  ASSERT (b != NULL);
+  printf ("%d-bit bitmaps, %d scans each (ticks: word-at-a-time / "
+          "bit-at-a-time)\n", BIT_CNT, SCAN_CNT);
+  for (i = 0; i < sizeof used_pcts / sizeof *used_pcts; i++)
+    for (j = 0; j < sizeof cnts / sizeof *cnts; j++)
+      benchmark (b, used_pcts[i], cnts[j]);
+  bitmap_destroy (b);
+
+  printf ("bitmap: PASS\n");
+}
+
+/* Marks USED_PCT percent of the bits in B, chosen at random, and
+   then times SCAN_CNT searches for CNT free bits from random
+   starting points with both algorithms. */
+static void
+benchmark (struct bitmap *b, int used_pct, size_t cnt)
+{
+  size_t starts[SCAN_CNT], found[SCAN_CNT];
+  int64_t fast, slow;
+  size_t i;
+
+  bitmap_set_all (b, false);
+  for (i = 0; i < BIT_CNT; i++)
+    if (random_ulong () % 100 < (unsigned long) used_pct)
+      bitmap_mark (b, i);
+  for (i = 0; i < SCAN_CNT; i++)
+    starts[i] = random_ulong () % BIT_CNT;
+
+  fast = timer_ticks ();
+  for (i = 0; i < SCAN_CNT; i++)
+    found[i] = bitmap_scan (b, starts[i], cnt, false);
+  fast = timer_elapsed (fast);
+
+  slow = timer_ticks ();
+  for (i = 0; i < SCAN_CNT; i++)
+    ASSERT (scan_naive (b, starts[i], cnt, false) == found[i]);
+  slow = timer_elapsed (slow);
+
+  printf ("%2d%% used, runs of %2zu: %"PRId64" / %"PRId64"\n",
+          used_pct, cnt, fast, slow);
+}
+
+/* The original bitmap_scan(): tries every starting index and
+   tests every bit of the window one at a time. */
+static size_t
+scan_naive (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t bit_cnt = bitmap_size (b);
+
+  if (cnt <= bit_cnt)
+    {
+      size_t last = bit_cnt - cnt;
+      size_t i, j;
+
+      for (i = start; i <= last; i++)
+        {
+          for (j = 0; j < cnt; j++)
+            if (bitmap_test (b, i + j) != value)
+              break;
+          if (j == cnt)
+            return i;
+        }
+    }
+  return BITMAP_ERROR;
+}
@@ -0,0 +1,123 @@
+/* Microbenchmark for global kernel mappings (threads/init.c).
+
+   Switches back and forth between two user page directories, as
+   a context switch between two processes does, and after each
+   switch touches a working set of kernel pages, as the kernel
+   does on the way into and out of a process.  Times the loop
+   with CR4.PGE set, so that the kernel's TLB entries survive
+   each CR3 load, and with it clear, so that every switch flushes
+   them, and reports the timer ticks each took.
+
+   To see the effect on whole workloads, run multi-process tests
+   such as page-parallel and multi-recurse with and without the
+   -noglobal kernel option and compare their timer statistics.
+
+   Build it into the kernel with "make INTERNAL_TEST=tlb" and run
+   it with "pintos -- internal".
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "userprog/pagedir.h"
+
+/* Flags in control register 4. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Number of kernel pages touched after each switch. */
+#define WORK_PAGES 64
+
+/* Number of switches timed for each configuration. */
+#define SWITCH_CNT 200000
+
+static uint32_t get_cr4 (void);
+static void set_cr4 (uint32_t);
+static int64_t benchmark (uint32_t *pd[2], volatile uint8_t *work[]);
+
+/* Times page directory switches with and without global pages. */
+void
+test (void)
+{
+  volatile uint8_t *work[WORK_PAGES];
+  uint32_t *pd[2];
+  uint32_t cr4 = get_cr4 ();
+  int64_t global, flushed;
+  size_t i;
+
+  pd[0] = pagedir_create ();
+  pd[1] = pagedir_create ();
+  ASSERT (pd[0] != NULL && pd[1] != NULL);
+  for (i = 0; i < WORK_PAGES; i++)
+    {
+      work[i] = palloc_get_page (PAL_ASSERT);
+      work[i][0] = i;
+    }
+
+  if ((cr4 & CR4_PGE) == 0)
+    printf ("warning: global pages are disabled (-noglobal or no CPU "
+            "support)\n");
+
+  set_cr4 (cr4 | CR4_PGE);
+  global = benchmark (pd, work);
+  set_cr4 (cr4 & ~CR4_PGE);
+  flushed = benchmark (pd, work);
+  set_cr4 (cr4);
+
+  printf ("%d switches, %d kernel pages touched after each\n",
+          SWITCH_CNT, WORK_PAGES);
+  printf ("global kernel pages: %"PRId64" ticks\n", global);
+  printf ("flushed kernel pages: %"PRId64" ticks\n", flushed);
+
+  for (i = 0; i < WORK_PAGES; i++)
+    palloc_free_page ((void *) work[i]);
+  pagedir_destroy (pd[0]);
+  pagedir_destroy (pd[1]);
+
+  printf ("tlb: PASS\n");
+}
+
+/* Activates PD[0] and PD[1] alternately SWITCH_CNT times,
+   reading from each page in WORK after every switch, and returns
+   the number of timer ticks that took. */
+static int64_t
+benchmark (uint32_t *pd[2], volatile uint8_t *work[])
+{
+  int64_t start;
+  size_t i, j;
+  unsigned sum = 0;
+
+  start = timer_ticks ();
+  for (i = 0; i < SWITCH_CNT; i++)
+    {
+      pagedir_activate (pd[i % 2]);
+      for (j = 0; j < WORK_PAGES; j++)
+        sum += work[j][0];
+    }
+  pagedir_activate (NULL);
+  ASSERT (sum == SWITCH_CNT * (WORK_PAGES * (WORK_PAGES - 1) / 2));
+  return timer_elapsed (start);
+}
+
+/* Returns control register 4. */
+static uint32_t
+get_cr4 (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Sets control register 4 to CR4.  Changing PGE flushes the
+   whole TLB, including global entries. */
+static void
+set_cr4 (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
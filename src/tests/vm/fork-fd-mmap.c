@@ -0,0 +1,52 @@
+/* Forks while a file is open and mapped.  The child must see
+   the mapping's contents and continue reading the file from the
+   parent's position.  Each process has its own file position
+   after the fork, so the child's reads do not move the
+   parent's. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char buf[16];
+  int handle;
+  mapid_t map;
+  pid_t pid;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  if (read (handle, buf, sizeof buf) != sizeof buf)
+    fail ("read \"sample.txt\" failed");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (memcmp (actual, sample, strlen (sample)))
+        fail ("child's mmap'd file has bad data");
+      if (tell (handle) != sizeof buf)
+        fail ("child's file position is %u (should be %zu)",
+              tell (handle), sizeof buf);
+      if (read (handle, buf, sizeof buf) != sizeof buf
+          || memcmp (buf, sample + sizeof buf, sizeof buf))
+        fail ("child read bad data");
+      msg ("child sees the open file and the mapping");
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  msg ("wait(fork()) = %d", wait (pid));
+  if (tell (handle) != sizeof buf)
+    fail ("parent's file position is %u (should be %zu)",
+          tell (handle), sizeof buf);
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("parent's mmap'd file has bad data");
+  munmap (map);
+  close (handle);
+}
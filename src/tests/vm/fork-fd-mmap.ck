@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-fd-mmap) begin
+(fork-fd-mmap) open "sample.txt"
+(fork-fd-mmap) mmap "sample.txt"
+(fork-fd-mmap) child sees the open file and the mapping
+fork-fd-mmap: exit(81)
+(fork-fd-mmap) wait(fork()) = 81
+(fork-fd-mmap) end
+fork-fd-mmap: exit(0)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Writes to the same pages from a parent and its forked child
+   and verifies that each process only sees its own writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 4096)
+
+static char buf[SIZE];
+
+static void
+check_buf (const char *who, char value)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != value)
+      fail ("byte %zu of buf is %02hhx in %s (should be %02hhx)",
+            i, buf[i], who, value);
+}
+
+void
+test_main (void)
+{
+  int local = 1;
+  pid_t pid;
+
+  memset (buf, 'a', sizeof buf);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* The parent may already have written its copy. */
+      check_buf ("child", 'a');
+      memset (buf, 'c', sizeof buf);
+      local = 2;
+      check_buf ("child", 'c');
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  memset (buf, 'p', sizeof buf);
+  msg ("wait(fork()) = %d", wait (pid));
+  if (local != 1)
+    fail ("child's write to stack is visible in parent");
+  check_buf ("parent", 'p');
+  msg ("parent's data is private");
+}
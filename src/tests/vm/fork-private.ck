@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-private) begin
+fork-private: exit(81)
+(fork-private) wait(fork()) = 81
+(fork-private) parent's data is private
+(fork-private) end
+fork-private: exit(0)
+EOF
+pass;
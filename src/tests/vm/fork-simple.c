@@ -0,0 +1,42 @@
+/* Forks a child process, which must see the parent's memory as
+   it was at the time of the fork and get 0 back from fork(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (3 * 4096)
+
+static int data = 0x1234;
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  char stack_buf[128];
+  pid_t pid;
+  size_t i;
+
+  memset (buf, 'a', sizeof buf);
+  memset (stack_buf, 's', sizeof stack_buf);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (data != 0x1234)
+        fail ("child sees data = %#x (should be 0x1234)", data);
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != 'a')
+          fail ("byte %zu of buf is %02hhx in child", i, buf[i]);
+      for (i = 0; i < sizeof stack_buf; i++)
+        if (stack_buf[i] != 's')
+          fail ("byte %zu of stack_buf is %02hhx in child", i, stack_buf[i]);
+      msg ("child sees parent's data");
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  msg ("wait(fork()) = %d", wait (pid));
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-simple) begin
+(fork-simple) child sees parent's data
+fork-simple: exit(81)
+(fork-simple) wait(fork()) = 81
+(fork-simple) end
+fork-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Fills 2 MB of memory, so that much of it is paged out, then
+   forks.  Half of the pages hold data that does not compress, so
+   both the compressed swap cache and the swap disk are used.
+   The child verifies and modifies the data, then the parent
+   verifies that its own copy is unchanged and modifies it too. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+
+static char buf[SIZE];
+
+/* Returns the initial value of byte I of buf. */
+static char
+value (size_t i)
+{
+  if (i & 4096)
+    return (i * 2654435761u) >> 24;
+  else
+    return i % 251;
+}
+
+static void
+verify (const char *who, int delta)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) (value (i) + delta))
+      fail ("byte %zu is %02hhx in %s (should be %02hhx)",
+            i, buf[i], who, (char) (value (i) + delta));
+}
+
+static void
+modify (int delta)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] += delta;
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+  size_t i;
+
+  msg ("initialize");
+  for (i = 0; i < SIZE; i++)
+    buf[i] = value (i);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      verify ("child", 0);
+      modify (3);
+      verify ("child", 3);
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  msg ("wait(fork()) = %d", wait (pid));
+  verify ("parent", 0);
+  modify (7);
+  verify ("parent", 7);
+  msg ("parent's data is intact");
+}
@@ -20,8 +20,13 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#ifdef INTERNAL_TEST
+#include "threads/test.h"
+#endif
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -34,16 +39,32 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/page.h"
+#include "vm/policy.h"
+#include "vm/pageout.h"
+#include "vm/vma.h"
+#include "vm/zswap.h"
+
+/* Flags in control register 4. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* CPUID function 1 feature flags in EDX. */
+#define CPUID_PSE (1 << 3)      /* 4 MB pages. */
+#define CPUID_PGE (1 << 13)     /* Global pages. */
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* True if user pages may be mapped 4 MB at a time. */
+bool init_large_pages;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -60,8 +81,16 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -kr: Number of pages user pages must leave free for the kernel. */
+static size_t kernel_page_reserve = SIZE_MAX;
+
+/* -noglobal: Do not mark kernel mappings global? */
+static bool no_global_pages;
+
 static void bss_init (void);
+static void ram_init (void);
 static void paging_init (void);
+static uint32_t cpu_features (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -82,6 +111,7 @@ int main (void)
 
   /* Clear BSS. */  
   bss_init ();
+  ram_init ();
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
@@ -96,9 +126,12 @@ int main (void)
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n", init_ram_pages * PGSIZE / 1024);
 
   /* Initialize memory system. */
-  palloc_init (user_page_limit);
+  palloc_init (user_page_limit, kernel_page_reserve);
   malloc_init ();
+  shrinker_init ();
+  slab_init ();
   paging_init ();
+  palloc_init_high ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -118,6 +151,8 @@ int main (void)
 
   /* init func for Project 3 */
   frame_table_init();
+  page_init();
+  vma_init();
   
 
   /* Start thread scheduler and enable interrupts. */
@@ -132,6 +167,9 @@ int main (void)
   filesys_init (format_filesys);
 #endif
   swap_table_init();
+  zswap_init();
+  pageout_init();
+  replace_policy_init();
 
   printf ("Boot complete.\n");
   
@@ -155,16 +193,55 @@ static void bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Sizes physical memory from the BIOS memory map, if start.S got
+   one: init_ram_pages becomes the end of the highest usable
+   region, capped at LOADER_MAX_RAM_PAGES.  Otherwise keeps the
+   (at most 64 MB) size that start.S found. */
+static void
+ram_init (void)
+{
+  uint64_t end = 0;
+  uint32_t i;
+
+  for (i = 0; i < init_e820_cnt; i++)
+    {
+      const struct e820_entry *e = &init_e820_map[i];
+      if (e->type == E820_USABLE && e->base + e->length > end)
+        end = e->base + e->length;
+    }
+  if (end == 0)
+    return;
+
+  if (end > (uint64_t) LOADER_MAX_RAM_PAGES * PGSIZE)
+    end = (uint64_t) LOADER_MAX_RAM_PAGES * PGSIZE;
+  init_ram_pages = end / PGSIZE;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   Every page directory shares these page tables, so the kernel
+   mapping is the same in all of them.  Its PTEs are therefore
+   marked global, when the CPU supports it, so that their TLB
+   entries survive the CR3 load of each process switch.  Kernel
+   PTEs never change after this point; if they did, each change
+   would need an INVLPG, since a CR3 load no longer flushes
+   them.
+
+   If the CPU supports 4 MB pages, they are enabled for use by
+   large user mappings (see pagedir_set_large_page()). */
 static void paging_init (void)
 {
   uint32_t *pd, *pt;
+  uint32_t features = cpu_features ();
+  uint32_t global, cr4;
   size_t page;
   extern char _start, _end_kernel_text;
 
+  global = !no_global_pages && (features & CPUID_PGE) ? PTE_G : 0;
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -181,7 +258,7 @@ static void paging_init (void)
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -190,6 +267,30 @@ static void paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  /* Enable global pages and 4 MB pages.  See [IA32-v3a] 2.5
+     "Control Registers" and 3.12 "Translation Lookaside Buffers
+     (TLBs)". */
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  if (global)
+    cr4 |= CR4_PGE;
+  if (features & CPUID_PSE)
+    {
+      cr4 |= CR4_PSE;
+      init_large_pages = true;
+    }
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Returns the feature flags that CPUID function 1 reports in EDX.
+   See [IA32-v2a] "CPUID--CPU Identification". */
+static uint32_t
+cpu_features (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
 }
 
 /* Breaks the kernel command line into words and returns them as an argv-like array. */
@@ -250,18 +351,46 @@ static char ** parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))  // 임시 장치 이름 설정
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-wb"))       // write-behind 기준 시간과 dirty 한도 설정
+        {
+          if (!cache_set_writeback (value))
+            PANIC ("invalid write-back parameters `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
 #ifdef VM
       else if (!strcmp (name, "-swap")) 
         swap_bdev_name = value;
+      else if (!strcmp (name, "-evict"))    // 페이지 교체 정책 선택
+        {
+          if (value == NULL || !replace_policy_select (value))
+            PANIC ("unknown page replacement policy `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
+      else if (!strcmp (name, "-pageout"))  // page-out daemon watermark 설정
+        {
+          if (!pageout_set_watermarks (value))
+            PANIC ("invalid page-out watermarks `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
+      else if (!strcmp (name, "-zswap"))    // 압축 swap pool 크기 설정
+        {
+          if (!zswap_set_pool_size (value))
+            PANIC ("invalid zswap pool size `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
 #endif
 #endif
       else if (!strcmp (name, "-rs"))       // 랜덤 시드 설정
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))    // MLFQS 스케줄러 활성화 
         thread_mlfqs = true;
+      else if (!strcmp (name, "-noglobal")) // 커널 매핑의 global 지정 해제
+        no_global_pages = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))       // 유저 페이지 제한 설정
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-kr"))       // 커널 예비 페이지 수 설정
+        kernel_page_reserve = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -294,6 +423,17 @@ static void run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+#ifdef INTERNAL_TEST
+/* Runs the internal test built into the kernel (see
+   threads/test.h). */
+static void run_internal (char **argv UNUSED)
+{
+  printf ("Executing internal test:\n");
+  test ();
+  printf ("Execution of internal test complete.\n");
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void run_actions (char **argv) 
@@ -310,6 +450,9 @@ static void run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},             // 유저 프로그램 실행
+#ifdef INTERNAL_TEST
+      {"internal", 1, run_internal},    // tests/internal의 내부 테스트 실행
+#endif
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},             // 파일 리스트 출력
       {"cat", 2, fsutil_cat},           // 파일 내용 출력
@@ -356,6 +499,9 @@ static void usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+#ifdef INTERNAL_TEST
+          "  internal           Run the internal test built into the kernel.\n"
+#endif
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -372,14 +518,24 @@ static void usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -wb=MSEC,CNT       Write back sectors dirty for MSEC ms, throttle\n"
+          "                     writers when over CNT sectors are dirty.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -evict=POLICY      Page replacement policy: clock (default),\n"
+          "                     wsclock, or lru.\n"
+          "  -pageout=LOW,HIGH  Start background page-out when fewer than LOW\n"
+          "                     user frames are free, stop at HIGH (0 = off).\n"
+          "  -zswap=PAGES       Keep up to PAGES kernel pages of compressed\n"
+          "                     swapped-out pages in RAM (0 = off).\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -noglobal          Flush kernel TLB entries on every CR3 load.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -kr=COUNT          Keep COUNT pages free for the kernel.\n"
 #endif
           );
   shutdown_power_off ();
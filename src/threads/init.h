@@ -9,4 +9,7 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* True if user pages may be mapped 4 MB at a time (CR4.PSE). */
+extern bool init_large_pages;
+
 #endif /* threads/init.h */
@@ -12,6 +12,21 @@
    Must be aligned on a 4 MB boundary. */
 #define LOADER_PHYS_BASE 0xc0000000     /* 3 GB. */
 
+/* Physical memory mapped by start.S's temporary page tables, in
+   4 kB pages (64 MB).  paging_init() maps the rest. */
+#define LOADER_BOOT_MAP_PAGES 0x4000
+
+/* Most physical memory the kernel uses, in 4 kB pages: all of the
+   kernel virtual address space above LOADER_PHYS_BASE except its
+   top 4 MB, so that addresses one past the end of RAM do not wrap
+   around to 0. */
+#define LOADER_MAX_RAM_PAGES 0x3fc00    /* 1020 MB. */
+
+/* BIOS memory map (E820) collected by start.S. */
+#define LOADER_E820_MAX 32              /* Maximum number of entries. */
+#define LOADER_E820_LEN 24              /* Size of an entry. */
+#define E820_USABLE 1                   /* Type of usable RAM. */
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)   /* 0xaa55 BIOS signature. */
 #define LOADER_PARTS (LOADER_SIG - LOADER_PARTS_LEN)     /* Partition table. */
@@ -35,6 +50,20 @@
 
 /* Amount of physical memory, in 4 kB pages. */
 extern uint32_t init_ram_pages;
+
+/* A BIOS memory map entry.  See [IntrList] INT 15h, AX=E820h. */
+struct e820_entry
+  {
+    uint64_t base;              /* Physical start address. */
+    uint64_t length;            /* Length in bytes. */
+    uint32_t type;              /* E820_USABLE or a reserved type. */
+    uint32_t attrs;             /* ACPI 3.0 extended attributes. */
+  } __attribute__ ((packed));
+
+/* BIOS memory map, and its number of entries (0 if the BIOS does
+   not support E820h). */
+extern struct e820_entry init_e820_map[LOADER_E820_MAX];
+extern uint32_t init_e820_cnt;
 #endif
 
 #endif /* threads/loader.h */
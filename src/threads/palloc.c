@@ -2,81 +2,225 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/shrinker.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
    hands out smaller chunks.
 
-   System memory is divided into two "pools" called the kernel
-   and user pools.  The user pool is for user (virtual) memory
-   pages, the kernel pool for everything else.  The idea here is
-   that the kernel needs to have memory for its own operations
-   even if user processes are swapping like mad.
+   All free memory above 1 MB forms a single pool shared by user
+   (virtual) memory pages and kernel data, so that either can
+   grow into memory the other is not using.  The kernel needs to
+   have memory for its own operations even if user processes are
+   swapping like mad, so user allocations must leave a reserve of
+   free pages for the kernel; when they would dip into it, the
+   registered shrinkers are asked to shrink kernel caches first
+   (see shrinker.c), and if that does not help the user
+   allocation fails, which makes the
+   frame allocator evict.  The -ul option still caps the number
+   of user pages.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   Only pages in usable regions of the BIOS memory map are ever
+   handed out.  start.S maps just the first 64 MB, so pages above
+   that are added by palloc_init_high() once paging_init() has
+   mapped all of RAM.
+
+   The pool is managed by a binary buddy allocator.  A free block
+   of order K is 2**K pages long and starts at a page index (from
+   the pool's base) that is a multiple of 2**K.  Free blocks are
+   kept on one list per order; the list element lives in the
+   first page of the free block itself.  An allocation of N pages
+   takes a block of the smallest order K with 2**K >= N, splitting
+   larger blocks as needed, and immediately frees the 2**K - N
+   pages it does not need.  Freeing a block merges it with its
+   "buddy" (the block whose index differs only in bit K) for as
+   long as the buddy is also free.
+
+   Pages may be freed with interrupts off (a dying thread's stack
+   is released during scheduling), so the free lists are
+   protected by disabling interrupts rather than by a lock.  Only
+   list manipulation happens with interrupts off; zeroing pages
+   does not. */
+
+/* Number of block orders.  The largest block is 2**(PALLOC_ORDERS - 1)
+   pages (1 GB). */
+#define PALLOC_ORDERS 19
+
+/* Request size, in pages, for which palloc_print_stats() reports
+   fragmentation. */
+#define PALLOC_FRAG_PAGES 16
+
+/* Default kernel reserve: this fraction of all usable pages. */
+#define PALLOC_RESERVE_DIV 8
+
+/* Values of a page's order[] entry when it does not begin a free
+   block: inside a free block or allocated to the kernel, or
+   allocated as a user page. */
+#define NOT_FREE 0xff
+#define USER_PAGE 0xfe
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *order;                     /* Order of the free block that
+                                           starts at each page, or NOT_FREE
+                                           or USER_PAGE. */
+    struct list free_list[PALLOC_ORDERS]; /* Free blocks of each order. */
+    size_t block_cnt[PALLOC_ORDERS];    /* Length of each free_list. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+    size_t usable_cnt;                  /* Number of pages ever freed. */
+    size_t user_cnt;                    /* Number of user pages in use. */
+  };
+
+/* A free block, stored in its own first page. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in free_list. */
   };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* The pool of all free memory. */
+static struct pool ram_pool;
+
+/* Kernel reserve and user page limit, in pages. */
+static size_t kernel_reserve;
+static size_t user_limit;
+
+/* Cache shrinking statistics. */
+static unsigned long long reclaim_cnt, reclaimed_pages;
+
+/* Usable physical memory, as sorted, non-overlapping ranges of
+   physical page numbers [start, end). */
+struct ram_range
+  {
+    size_t start;
+    size_t end;
+  };
+static struct ram_range usable[LOADER_E820_MAX];
+static size_t usable_cnt;
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
+static void init_usable (void);
+static size_t pool_meta_size (size_t page_cnt);
+static void init_pool (struct pool *, void *meta, void *base,
+                       size_t page_cnt);
+static void release_usable (struct pool *, size_t lo, size_t hi);
 static bool page_from_pool (const struct pool *, void *page);
+static bool user_may_alloc (const struct pool *, size_t page_cnt);
+static size_t reclaim (size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static size_t buddy_alloc_aligned (struct pool *, size_t page_cnt,
+                                   size_t align);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_free_block (struct pool *, size_t page_idx, int order);
+static void free_block_insert (struct pool *, size_t page_idx, int order);
+static void free_block_remove (struct pool *, size_t page_idx, int order);
+static int order_for (size_t page_cnt);
 
-/* Initializes the page allocator.  At most USER_PAGE_LIMIT pages are put into the user pool. */
-void palloc_init (size_t user_page_limit)
+/* Initializes the page allocator.  At most USER_PAGE_LIMIT pages
+   are used for user pages, and user pages always leave
+   KERNEL_RESERVE pages free (SIZE_MAX for the default). */
+void palloc_init (size_t user_page_limit, size_t kernel_page_reserve)
 {
   /* Free memory starts at 1 MB and runs to the end of RAM. */
   /* 1MB 이전 공간은 보통 BIOS, 부트 로더와 같은 시스템 초기화 과정에 사용 */
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  size_t meta_pages;
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE, user_pages, "user pool");
+  /* The pool's bookkeeping goes at its start, which start.S has
+     mapped. */
+  meta_pages = DIV_ROUND_UP (pool_meta_size (free_pages), PGSIZE);
+  if (meta_pages >= free_pages)
+    PANIC ("Not enough memory in pool for bitmap.");
+
+  init_usable ();
+  init_pool (&ram_pool, free_start, free_start + meta_pages * PGSIZE,
+             free_pages - meta_pages);
+  release_usable (&ram_pool, 0, LOADER_BOOT_MAP_PAGES);
+  user_limit = user_page_limit;
+  kernel_reserve = kernel_page_reserve;
+}
+
+/* Adds the usable pages that start.S did not map to the pool and
+   sets the default kernel reserve.  Must be called after
+   paging_init() maps all of RAM. */
+void
+palloc_init_high (void)
+{
+  release_usable (&ram_pool, LOADER_BOOT_MAP_PAGES, init_ram_pages);
+  if (kernel_reserve == SIZE_MAX)
+    kernel_reserve = ram_pool.usable_cnt / PALLOC_RESERVE_DIV;
+
+  printf ("%zu pages available in pool, %zu reserved for the kernel.\n",
+          ram_pool.free_cnt, kernel_reserve);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   If PAL_USER is set, the pages are user pages, which must leave
+   the kernel reserve free.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   available, even after shrinking kernel caches, returns a null
+   pointer, unless PAL_ASSERT is set in FLAGS, in which case the
+   kernel panics. */
 void * palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
-  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  return palloc_get_aligned (flags, page_cnt, 1);
+}
+
+/* Like palloc_get_multiple(), but the physical address of the
+   first page is a multiple of ALIGN pages, which must be a power
+   of 2.  Used for 4 MB user pages.  The pages may be freed
+   separately. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt, size_t align)
+{
+  struct pool *pool = &ram_pool;
+  bool user = (flags & PAL_USER) != 0;
+  bool reclaimed = false;
   void *pages;
   size_t page_idx;
+  enum intr_level old_level;
 
+  ASSERT (align > 0 && (align & (align - 1)) == 0);
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  for (;;)
+    {
+      old_level = intr_disable ();
+      if (!user || user_may_alloc (pool, page_cnt))
+        page_idx = (align == 1 ? buddy_alloc (pool, page_cnt)
+                    : buddy_alloc_aligned (pool, page_cnt, align));
+      else
+        page_idx = BITMAP_ERROR;
+      if (page_idx != BITMAP_ERROR)
+        {
+          bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+          if (user)
+            {
+              memset (pool->order + page_idx, USER_PAGE, page_cnt);
+              pool->user_cnt += page_cnt;
+            }
+        }
+      intr_set_level (old_level);
+
+      /* On failure, shrink kernel caches once and retry. */
+      if (page_idx != BITMAP_ERROR || reclaimed || reclaim (page_cnt) == 0)
+        break;
+      reclaimed = true;
+    }
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -97,8 +241,8 @@ void * palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
 /* Obtains a single free page and returns its kernel virtual
    address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   If PAL_USER is set, the page is a user page, which must leave
+   the kernel reserve free.  If PAL_ZERO is set in FLAGS,
    then the page is filled with zeros.  If no pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
@@ -111,18 +255,15 @@ void * palloc_get_page (enum palloc_flags flags)
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
-  struct pool *pool;
+  struct pool *pool = &ram_pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
+  if (!page_from_pool (pool, pages))
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
@@ -131,8 +272,16 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  if (pool->order[page_idx] == USER_PAGE)
+    {
+      memset (pool->order + page_idx, NOT_FREE, page_cnt);
+      pool->user_cnt -= page_cnt;
+    }
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -142,23 +291,196 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
-static void init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+/* Returns the kernel virtual address of the first page that can
+   be a user page.  Together with palloc_user_pool_size(), lets
+   callers keep per-frame metadata in an array indexed by
+   (kpage - palloc_user_pool_base ()) / PGSIZE.  Since user and
+   kernel pages share one pool, this covers all of it. */
+void *
+palloc_user_pool_base (void)
 {
-  /* We'll put the pool's used_map at its base. 
-     Calculate the space needed for the bitmap and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE); 
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages; // bm_pages : bit_map 할당에 필요한 페이지 수
+  return ram_pool.base;
+}
 
-  printf ("%zu pages available in %s.\n", page_cnt, name);
+/* Returns the number of pages that can be user pages. */
+size_t
+palloc_user_pool_size (void)
+{
+  return ram_pool.page_cnt;
+}
+
+/* Returns the number of pages that user allocations can still
+   take: free pages beyond the kernel reserve, up to the user page
+   limit. */
+size_t
+palloc_user_free_cnt (void)
+{
+  const struct pool *pool = &ram_pool;
+  size_t cnt, limit_cnt;
+
+  cnt = pool->free_cnt > kernel_reserve ? pool->free_cnt - kernel_reserve : 0;
+  limit_cnt = user_limit > pool->user_cnt ? user_limit - pool->user_cnt : 0;
+  return cnt < limit_cnt ? cnt : limit_cnt;
+}
+
+/* Returns the fragmentation of the pool with respect to requests
+   of PAGE_CNT pages, in percent: the share of free pages that
+   lie in free blocks too small to satisfy such a request.  0
+   means every free page is usable for it; 100 means the request
+   fails even though pages may be free. */
+unsigned
+palloc_fragmentation (size_t page_cnt)
+{
+  struct pool *pool = &ram_pool;
+  int order = order_for (page_cnt);
+  size_t free_cnt, small_cnt = 0;
+  enum intr_level old_level;
+  int k;
+
+  old_level = intr_disable ();
+  free_cnt = pool->free_cnt;
+  for (k = 0; k < order && k < PALLOC_ORDERS; k++)
+    small_cnt += pool->block_cnt[k] << k;
+  intr_set_level (old_level);
+
+  return free_cnt > 0 ? small_cnt * 100 / free_cnt : 0;
+}
+
+/* Prints page usage, fragmentation and reclaim statistics. */
+void
+palloc_print_stats (void)
+{
+  const struct pool *pool = &ram_pool;
+  size_t kernel_cnt = pool->usable_cnt - pool->free_cnt - pool->user_cnt;
+  int k;
+
+  printf ("Palloc: %zu of %zu pages free, %zu user, %zu kernel "
+          "(reserve %zu), %u%% unusable for %d-page requests; "
+          "free blocks by order:",
+          pool->free_cnt, pool->usable_cnt, pool->user_cnt, kernel_cnt,
+          kernel_reserve, palloc_fragmentation (PALLOC_FRAG_PAGES),
+          PALLOC_FRAG_PAGES);
+  for (k = 0; k < PALLOC_ORDERS; k++)
+    if (pool->block_cnt[k] > 0)
+      printf (" %d:%zu", k, pool->block_cnt[k]);
+  printf ("\nPalloc: %llu reclaim calls, %llu pages reclaimed\n",
+          reclaim_cnt, reclaimed_pages);
+}
+
+/* Collects the usable regions of the BIOS memory map, below
+   init_ram_pages, into USABLE.  Without a memory map, all of
+   init_ram_pages is usable. */
+static void
+init_usable (void)
+{
+  uint32_t i;
+
+  if (init_e820_cnt == 0)
+    {
+      usable[0].start = 0;
+      usable[0].end = init_ram_pages;
+      usable_cnt = 1;
+      return;
+    }
+
+  for (i = 0; i < init_e820_cnt; i++)
+    {
+      const struct e820_entry *e = &init_e820_map[i];
+      uint64_t start = DIV_ROUND_UP (e->base, PGSIZE);
+      uint64_t end = (e->base + e->length) / PGSIZE;
+      struct ram_range r;
+      size_t j;
+
+      if (e->type != E820_USABLE)
+        continue;
+      if (end > init_ram_pages)
+        end = init_ram_pages;
+      if (start >= end)
+        continue;
+
+      /* Insert in order of start page. */
+      r.start = start;
+      r.end = end;
+      for (j = usable_cnt++; j > 0 && usable[j - 1].start > r.start; j--)
+        usable[j] = usable[j - 1];
+      usable[j] = r;
+    }
+
+  /* Merge overlapping regions, which some BIOSes report. */
+  if (usable_cnt > 0)
+    {
+      size_t n = 0;
+
+      for (i = 1; i < usable_cnt; i++)
+        if (usable[i].start <= usable[n].end)
+          {
+            if (usable[i].end > usable[n].end)
+              usable[n].end = usable[i].end;
+          }
+        else
+          usable[++n] = usable[i];
+      usable_cnt = n + 1;
+    }
+}
+
+/* Returns the number of bytes of bookkeeping for a pool of
+   PAGE_CNT pages: its used_map and its order array. */
+static size_t
+pool_meta_size (size_t page_cnt)
+{
+  return ROUND_UP (bitmap_buf_size (page_cnt), sizeof (long)) + page_cnt;
+}
+
+/* Initializes pool P as starting at BASE and holding PAGE_CNT
+   pages, with its bookkeeping at META.  All pages start out in
+   use; release_usable() frees the ones that are usable RAM. */
+static void init_pool (struct pool *p, void *meta, void *base, size_t page_cnt) 
+{
+  size_t bm_size = ROUND_UP (bitmap_buf_size (page_cnt), sizeof (long));
+  int k;
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE; // bit_map이 차지한 공간만큼 base를 이동
+  p->used_map = bitmap_create_in_buf (page_cnt, meta, bm_size);
+  bitmap_set_all (p->used_map, true);
+  p->order = (uint8_t *) meta + bm_size;
+  memset (p->order, NOT_FREE, page_cnt);
+  p->base = base;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->usable_cnt = 0;
+  p->user_cnt = 0;
+  for (k = 0; k < PALLOC_ORDERS; k++)
+    {
+      list_init (&p->free_list[k]);
+      p->block_cnt[k] = 0;
+    }
+}
+
+/* Frees the usable pages of pool P whose physical page numbers
+   are in [LO, HI). */
+static void
+release_usable (struct pool *p, size_t lo, size_t hi)
+{
+  size_t first = vtop (p->base) / PGSIZE;
+  size_t i;
+
+  if (lo < first)
+    lo = first;
+  if (hi > first + p->page_cnt)
+    hi = first + p->page_cnt;
+
+  for (i = 0; i < usable_cnt; i++)
+    {
+      size_t start = usable[i].start > lo ? usable[i].start : lo;
+      size_t end = usable[i].end < hi ? usable[i].end : hi;
+
+      if (start < end)
+        {
+          bitmap_set_multiple (p->used_map, start - first, end - start, false);
+          buddy_free (p, start - first, end - start);
+          p->usable_cnt += end - start;
+        }
+    }
 }
 
 /* Returns true if PAGE was allocated from POOL, false otherwise. */
@@ -166,7 +488,187 @@ static bool page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns true if a user allocation of PAGE_CNT pages from POOL
+   stays within the user page limit and leaves the kernel reserve
+   free.  Interrupts must be off. */
+static bool
+user_may_alloc (const struct pool *pool, size_t page_cnt)
+{
+  return pool->user_cnt + page_cnt <= user_limit
+         && pool->free_cnt >= page_cnt + kernel_reserve;
+}
+
+/* Asks the shrinkers to free PAGE_CNT pages by shrinking kernel
+   caches, and returns the number of pages they freed.  Does
+   nothing where the shrinkers could not take a lock. */
+static size_t
+reclaim (size_t page_cnt)
+{
+  size_t cnt;
+
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    return 0;
+
+  cnt = shrink_caches (page_cnt);
+  reclaim_cnt++;
+  reclaimed_pages += cnt;
+  return cnt;
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL and returns the index
+   of the first one, or BITMAP_ERROR if no free block is large
+   enough.  Interrupts must be off. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  int order = order_for (page_cnt);
+  size_t page_idx;
+  int k;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (order >= PALLOC_ORDERS)
+    return BITMAP_ERROR;
+
+  /* Smallest order with a free block.  For single pages this is
+     normally order 0 itself. */
+  for (k = order; k < PALLOC_ORDERS; k++)
+    if (!list_empty (&pool->free_list[k]))
+      break;
+  if (k == PALLOC_ORDERS)
+    return BITMAP_ERROR;
+
+  page_idx = (uint8_t *) list_front (&pool->free_list[k]) - pool->base;
+  page_idx /= PGSIZE;
+  free_block_remove (pool, page_idx, k);
+
+  /* Split: the upper half of each larger block goes back. */
+  while (k > order)
+    {
+      k--;
+      free_block_insert (pool, page_idx + ((size_t) 1 << k), k);
+    }
+
+  /* Give back the tail that the request does not need. */
+  if (page_cnt < (size_t) 1 << order)
+    buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL whose first page has
+   a physical page number that is a multiple of ALIGN, and
+   returns the index of the first one, or BITMAP_ERROR if no free
+   block contains such a run.  The parts of the chosen block
+   before and after the run go back to the free lists.
+   Interrupts must be off. */
+static size_t
+buddy_alloc_aligned (struct pool *pool, size_t page_cnt, size_t align)
+{
+  size_t base_pg = pg_no (pool->base) - pg_no (PHYS_BASE);
+  int k;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (k = order_for (page_cnt); k < PALLOC_ORDERS; k++)
+    {
+      struct list_elem *e;
+
+      for (e = list_begin (&pool->free_list[k]);
+           e != list_end (&pool->free_list[k]); e = list_next (e))
+        {
+          size_t block = ((uint8_t *) e - pool->base) / PGSIZE;
+          size_t end = block + ((size_t) 1 << k);
+          size_t start = ROUND_UP (base_pg + block, align) - base_pg;
+
+          if (start + page_cnt <= end)
+            {
+              free_block_remove (pool, block, k);
+              buddy_free (pool, block, start - block);
+              buddy_free (pool, start + page_cnt, end - start - page_cnt);
+              return start;
+            }
+        }
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL,
+   splitting the range into the largest aligned blocks it
+   contains.  Interrupts must be off. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int k = 0;
+
+      while (k + 1 < PALLOC_ORDERS
+             && page_idx % ((size_t) 2 << k) == 0
+             && ((size_t) 2 << k) <= page_cnt)
+        k++;
+      buddy_free_block (pool, page_idx, k);
+      page_idx += (size_t) 1 << k;
+      page_cnt -= (size_t) 1 << k;
+    }
+}
+
+/* Returns the free block of ORDER at PAGE_IDX to POOL, merging
+   it with its buddy as long as the buddy is free as a whole. */
+static void
+buddy_free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order + 1 < PALLOC_ORDERS)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->order[buddy] != order)
+        break;
+      free_block_remove (pool, buddy, order);
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  free_block_insert (pool, page_idx, order);
+}
+
+/* Adds the block of ORDER at PAGE_IDX to POOL's free lists. */
+static void
+free_block_insert (struct pool *pool, size_t page_idx, int order)
+{
+  struct free_block *b = (struct free_block *) (pool->base + PGSIZE * page_idx);
+
+  ASSERT (pool->order[page_idx] == NOT_FREE);
+  pool->order[page_idx] = order;
+  list_push_front (&pool->free_list[order], &b->elem);
+  pool->block_cnt[order]++;
+  pool->free_cnt += (size_t) 1 << order;
+}
+
+/* Removes the block of ORDER at PAGE_IDX from POOL's free lists. */
+static void
+free_block_remove (struct pool *pool, size_t page_idx, int order)
+{
+  struct free_block *b = (struct free_block *) (pool->base + PGSIZE * page_idx);
+
+  ASSERT (pool->order[page_idx] == order);
+  pool->order[page_idx] = NOT_FREE;
+  list_remove (&b->elem);
+  pool->block_cnt[order]--;
+  pool->free_cnt -= (size_t) 1 << order;
+}
+
+/* Returns the smallest K such that 2**K >= PAGE_CNT. */
+static int
+order_for (size_t page_cnt)
+{
+  int k = 0;
+
+  while (((size_t) 1 << k) < page_cnt)
+    k++;
+  return k;
+}
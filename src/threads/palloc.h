@@ -11,10 +11,18 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
-void palloc_init (size_t user_page_limit);
+void palloc_init (size_t user_page_limit, size_t kernel_page_reserve);
+void palloc_init_high (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_aligned (enum palloc_flags, size_t page_cnt, size_t align);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
 
+void *palloc_user_pool_base (void);
+size_t palloc_user_pool_size (void);
+size_t palloc_user_free_cnt (void);
+unsigned palloc_fragmentation (size_t page_cnt);
+void palloc_print_stats (void);
+
 #endif /* threads/palloc.h */
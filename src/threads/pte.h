@@ -65,7 +65,9 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_W 0x2               /* 1=read/write, 0=read-only. */
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
-#define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs and large PDEs). */
+#define PTE_PS 0x80             /* 1=maps a 4 MB page (PDEs only). */
+#define PTE_G 0x100             /* 1=global, 0=flushed on CR3 load (PTEs only). */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -73,10 +75,27 @@ static inline uint32_t pde_create (uint32_t *pt) {
   return vtop (pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB page that starts at PAGE,
+   which must be 4 MB aligned, as a user page.  If WRITABLE is
+   true then it will be writable as well.  Requires CR4.PSE.  See
+   [IA32-v3a] 3.7.3 "Mixing 4-KByte and 4-MByte Pages". */
+static inline uint32_t pde_create_large (void *page, bool writable) {
+  ASSERT (vtop (page) % PTSPAN == 0);
+  return vtop (page) | PTE_PS | PTE_U | PTE_P | (writable ? PTE_W : 0);
+}
+
+/* Returns true if PDE, which must be "present", maps a 4 MB page
+   rather than pointing to a page table. */
+static inline bool pde_is_large (uint32_t pde) {
+  ASSERT (pde & PTE_P);
+  return (pde & PTE_PS) != 0;
+}
+
 /* Returns a pointer to the page table that page directory entry
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
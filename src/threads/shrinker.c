@@ -0,0 +1,135 @@
+#include "threads/shrinker.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/synch.h"
+
+/* Shrinker registry.
+
+   Kernel caches (object caches, and later buffer and inode
+   caches) keep memory around that they could give back.  Each
+   registers a struct shrinker with a count callback, which
+   reports how many pages it could free, and a scan callback,
+   which frees up to a requested number of them.
+
+   When an allocation fails, or a user allocation would dip into
+   the kernel reserve, the page allocator calls shrink_caches()
+   before it gives up; only then does the frame allocator evict
+   user pages, or a PAL_ASSERT allocation panic.  shrink_caches()
+   first asks each shrinker for a share of the request
+   proportional to its count, so that large caches give back more
+   than small ones.  If that does not free enough pages, a second
+   pass asks each shrinker for everything it reported.
+
+   Count and scan callbacks run in the context of the failed
+   allocation, which may hold arbitrary locks, including the lock
+   of the cache being shrunk.  They must therefore not block on
+   their own locks: a callback skips a lock that the current
+   thread already holds, checked with
+   lock_held_by_current_thread(), and otherwise only
+   try-acquires it.  The check must come first, because
+   lock_try_acquire() asserts that the caller does not hold the
+   lock.  shrink_caches() treats SHRINKER_LOCK the same way, so
+   it does nothing if it is re-entered, for example by an
+   allocation made in a scan callback, or if another thread is
+   shrinking. */
+
+/* All registered shrinkers. */
+static struct list shrinker_list;
+static struct lock shrinker_lock;
+
+/* Number of shrink_caches() calls. */
+static unsigned long long shrink_cnt;
+
+/* Initializes the shrinker registry. */
+void
+shrinker_init (void)
+{
+  list_init (&shrinker_list);
+  lock_init (&shrinker_lock);
+}
+
+/* Registers shrinker S, whose NAME, COUNT, and SCAN members must
+   already be set.  S must stay valid for as long as the kernel
+   runs. */
+void
+shrinker_register (struct shrinker *s)
+{
+  ASSERT (s != NULL && s->count != NULL && s->scan != NULL);
+
+  s->scan_cnt = s->freed_pages = 0;
+  lock_acquire (&shrinker_lock);
+  list_push_back (&shrinker_list, &s->elem);
+  lock_release (&shrinker_lock);
+}
+
+/* Asks the registered shrinkers to free about PAGE_CNT pages and
+   returns the number of pages they freed.  Returns 0 without
+   shrinking anything if another shrink is in progress. */
+size_t
+shrink_caches (size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t total = 0, freed = 0;
+  int pass;
+
+  if (page_cnt == 0 || lock_held_by_current_thread (&shrinker_lock)
+      || !lock_try_acquire (&shrinker_lock))
+    return 0;
+  shrink_cnt++;
+
+  for (e = list_begin (&shrinker_list); e != list_end (&shrinker_list);
+       e = list_next (e))
+    total += list_entry (e, struct shrinker, elem)->count ();
+
+  /* Pass 0 asks for a proportional share, pass 1 for the rest. */
+  for (pass = 0; pass < 2 && total > 0 && freed < page_cnt; pass++)
+    for (e = list_begin (&shrinker_list); e != list_end (&shrinker_list);
+         e = list_next (e))
+      {
+        struct shrinker *s = list_entry (e, struct shrinker, elem);
+        size_t cnt = s->count ();
+        size_t nr, got;
+
+        if (cnt == 0)
+          continue;
+        if (pass == 0)
+          {
+            /* Round up so that small caches still get asked. */
+            nr = DIV_ROUND_UP ((uint64_t) cnt * page_cnt, total);
+            if (nr > cnt)
+              nr = cnt;
+          }
+        else
+          nr = cnt;
+
+        got = s->scan (nr);
+        s->scan_cnt++;
+        s->freed_pages += got;
+        freed += got;
+      }
+
+  lock_release (&shrinker_lock);
+  return freed;
+}
+
+/* Prints statistics for every shrinker. */
+void
+shrinker_print_stats (void)
+{
+  struct list_elem *e;
+
+  lock_acquire (&shrinker_lock);
+  printf ("Shrinker: %llu shrink calls\n", shrink_cnt);
+  for (e = list_begin (&shrinker_list); e != list_end (&shrinker_list);
+       e = list_next (e))
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+
+      printf ("Shrinker %s: %zu pages freeable, %llu scans, "
+              "%llu pages freed\n",
+              s->name, s->count (), s->scan_cnt, s->freed_pages);
+    }
+  lock_release (&shrinker_lock);
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_SHRINKER_H
+#define THREADS_SHRINKER_H
+
+#include <list.h>
+#include <stddef.h>
+
+/* Memory-pressure callbacks for kernel caches.
+
+   A cache that holds pages it could give back registers a
+   shrinker.  When the page allocator runs short, it asks every
+   shrinker to free pages in proportion to how many it holds.
+   See shrinker.c for details. */
+
+/* Returns the number of pages the cache could free right now.
+   Must not sleep for long; an estimate is fine. */
+typedef size_t shrinker_count_func (void);
+
+/* Tries to free up to PAGE_CNT pages and returns the number of
+   pages actually freed.  Must not allocate pages. */
+typedef size_t shrinker_scan_func (size_t page_cnt);
+
+/* A registered shrinker. */
+struct shrinker
+  {
+    const char *name;                   /* Name, for statistics. */
+    shrinker_count_func *count;         /* Reports freeable pages. */
+    shrinker_scan_func *scan;           /* Frees pages. */
+    unsigned long long scan_cnt;        /* Number of scan calls. */
+    unsigned long long freed_pages;     /* Pages freed by scan calls. */
+    struct list_elem elem;              /* Element in shrinker list. */
+  };
+
+void shrinker_init (void);
+void shrinker_register (struct shrinker *);
+size_t shrink_caches (size_t page_cnt);
+void shrinker_print_stats (void);
+
+#endif /* threads/shrinker.h */
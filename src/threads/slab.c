@@ -0,0 +1,423 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator in the style of Bonwick's object caches.
+
+   Each cache manages objects of a single size.  Memory comes
+   from the page allocator one page at a time; each such page is
+   a "slab" that begins with a header, followed by an array of
+   free slot indexes and then the object slots themselves.  The
+   free indexes are kept outside the slots so that a free object
+   keeps whatever its constructor put there.
+
+   Slabs with at least one free slot are on the cache's partial
+   list, slabs with no object in use are on its empty list, and
+   full slabs are on no list at all.  An object is mapped back to
+   its slab by rounding its address down to a page boundary.
+
+   Allocation prefers partial slabs, then empty slabs, and only
+   then asks the page allocator for a new page.  When a slab
+   becomes entirely free, it is kept for reuse if the cache has
+   fewer than SLAB_MAX_EMPTY empty slabs; otherwise its page is
+   returned to the page allocator right away.  kmem_cache_shrink()
+   releases all remaining empty slabs, and the "slab" shrinker
+   releases empty slabs of every cache when memory runs short. */
+
+/* Number of empty slabs a cache keeps for reuse. */
+#define SLAB_MAX_EMPTY 1
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x5a1bca7e
+
+/* Object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Slot size in bytes. */
+    size_t objs_per_slab;       /* Number of slots in a slab. */
+    size_t obj_ofs;             /* Offset of the first slot in a slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects everything below. */
+    struct list partial;        /* Slabs with free and used slots. */
+    struct list empty;          /* Slabs with no used slots. */
+    size_t empty_cnt;           /* Length of EMPTY. */
+    size_t slab_cnt;            /* Pages currently owned by the cache. */
+    size_t active_cnt;          /* Objects currently allocated. */
+    size_t peak_cnt;            /* Maximum of ACTIVE_CNT. */
+    unsigned long long alloc_cnt;   /* Number of allocations. */
+    unsigned long long free_cnt;    /* Number of frees. */
+    unsigned long long grow_cnt;    /* Pages taken from palloc. */
+    unsigned long long reclaim_cnt; /* Pages given back to palloc. */
+    struct list_elem elem;      /* Element in cache_list. */
+  };
+
+/* Slab header, at the beginning of each slab page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in partial or empty list. */
+    size_t used_cnt;            /* Number of slots in use. */
+    size_t free_top;            /* Number of entries in FREE_IDX. */
+    uint16_t free_idx[];        /* Stack of free slot indexes. */
+  };
+
+/* All caches, for statistics and reclaim. */
+static struct list cache_list;
+static struct lock cache_list_lock;
+
+static size_t slab_count (void);
+static size_t slab_scan (size_t page_cnt);
+static size_t shrink_locked (struct kmem_cache *, size_t max_cnt);
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct kmem_cache *, struct slab *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_to_obj (struct kmem_cache *, struct slab *, size_t idx);
+
+/* Gives empty slabs back under memory pressure. */
+static struct shrinker slab_shrinker =
+  {
+    .name = "slab",
+    .count = slab_count,
+    .scan = slab_scan,
+  };
+
+/* Initializes the slab allocator. */
+void
+slab_init (void)
+{
+  list_init (&cache_list);
+  lock_init (&cache_list_lock);
+  shrinker_register (&slab_shrinker);
+}
+
+/* Creates and returns a cache of SIZE-byte objects named NAME.
+   If CTOR is nonnull, it is called on every object when its slab
+   is created.  Panics if the cache cannot be created, since
+   caches are only created during initialization. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+  size_t obj_size, n;
+
+  ASSERT (size > 0);
+
+  /* Objects are pointer-aligned; the slot index must fit in the
+     16-bit free stack. */
+  obj_size = ROUND_UP (size, sizeof (void *));
+  n = (PGSIZE - sizeof (struct slab)) / (obj_size + sizeof (uint16_t));
+  while (n > 0
+         && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                      sizeof (void *)) + n * obj_size > PGSIZE)
+    n--;
+  if (n == 0)
+    PANIC ("kmem_cache_create: %zu-byte objects do not fit in a slab", size);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("kmem_cache_create: out of memory creating cache %s", name);
+
+  c->name = name;
+  c->obj_size = obj_size;
+  c->objs_per_slab = n;
+  c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                         sizeof (void *));
+  c->ctor = ctor;
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->empty_cnt = c->slab_cnt = c->active_cnt = c->peak_cnt = 0;
+  c->alloc_cnt = c->free_cnt = c->grow_cnt = c->reclaim_cnt = 0;
+
+  lock_acquire (&cache_list_lock);
+  list_push_back (&cache_list, &c->elem);
+  lock_release (&cache_list_lock);
+  return c;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+
+  /* Find a slab with a free slot, growing the cache if needed. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take a slot.  A slab that is now full leaves the partial
+     list. */
+  ASSERT (s->free_top > 0);
+  obj = slab_to_obj (c, s, s->free_idx[--s->free_top]);
+  if (++s->used_cnt == c->objs_per_slab)
+    list_remove (&s->elem);
+
+  c->alloc_cnt++;
+  if (++c->active_cnt > c->peak_cnt)
+    c->peak_cnt = c->active_cnt;
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Obtains an object from cache C and fills it with zeroes.
+   Only for caches without a constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c)
+{
+  void *obj;
+
+  ASSERT (c->ctor == NULL);
+  obj = kmem_cache_alloc (c);
+  if (obj != NULL)
+    memset (obj, 0, c->obj_size);
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to C.
+   Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     the cache promises that free objects stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->used_cnt > 0);
+
+  /* A full slab is on no list; it becomes partial again. */
+  if (s->used_cnt == c->objs_per_slab)
+    list_push_front (&c->partial, &s->elem);
+  s->free_idx[s->free_top++] = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs)
+                               / c->obj_size;
+
+  /* Keep a few empty slabs around, give the rest back. */
+  if (--s->used_cnt == 0)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < SLAB_MAX_EMPTY)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        slab_destroy (c, s);
+    }
+
+  c->free_cnt++;
+  c->active_cnt--;
+  lock_release (&c->lock);
+}
+
+/* Returns every empty slab of cache C to the page allocator.
+   Returns the number of pages released. */
+size_t
+kmem_cache_shrink (struct kmem_cache *c)
+{
+  size_t cnt;
+
+  lock_acquire (&c->lock);
+  cnt = shrink_locked (c, SIZE_MAX);
+  lock_release (&c->lock);
+  return cnt;
+}
+
+/* Prints statistics for every cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  lock_acquire (&cache_list_lock);
+  for (e = list_begin (&cache_list); e != list_end (&cache_list);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      printf ("Slab %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%zu pages, %llu allocs, %llu frees, "
+              "%llu pages grown, %llu reclaimed\n",
+              c->name, c->obj_size, c->active_cnt, c->peak_cnt,
+              c->slab_cnt, c->alloc_cnt, c->free_cnt,
+              c->grow_cnt, c->reclaim_cnt);
+    }
+  lock_release (&cache_list_lock);
+}
+
+/* Shrinker count callback: returns the number of empty slabs in
+   all caches, or 0 if the cache list is locked.  Reads the
+   per-cache counts without locking, since an estimate is
+   enough. */
+static size_t
+slab_count (void)
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  if (lock_held_by_current_thread (&cache_list_lock)
+      || !lock_try_acquire (&cache_list_lock))
+    return 0;
+  for (e = list_begin (&cache_list); e != list_end (&cache_list);
+       e = list_next (e))
+    cnt += list_entry (e, struct kmem_cache, elem)->empty_cnt;
+  lock_release (&cache_list_lock);
+  return cnt;
+}
+
+/* Shrinker scan callback: returns up to PAGE_CNT empty slabs to
+   the page allocator and returns the number of pages freed.  The
+   page allocator may call this while the current thread holds a
+   cache's lock (to grow that cache), so caches whose lock is
+   held, by the current thread or another one, are skipped.
+   lock_try_acquire() must not be called on a lock the caller
+   already holds, so that case is checked first. */
+static size_t
+slab_scan (size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  if (lock_held_by_current_thread (&cache_list_lock)
+      || !lock_try_acquire (&cache_list_lock))
+    return 0;
+  for (e = list_begin (&cache_list);
+       e != list_end (&cache_list) && cnt < page_cnt; e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      if (!lock_held_by_current_thread (&c->lock)
+          && lock_try_acquire (&c->lock))
+        {
+          cnt += shrink_locked (c, page_cnt - cnt);
+          lock_release (&c->lock);
+        }
+    }
+  lock_release (&cache_list_lock);
+  return cnt;
+}
+
+/* Returns up to MAX_CNT empty slabs of cache C to the page
+   allocator and returns the number of pages released.  C's lock
+   must be held. */
+static size_t
+shrink_locked (struct kmem_cache *c, size_t max_cnt)
+{
+  size_t cnt = 0;
+
+  while (cnt < max_cnt && !list_empty (&c->empty))
+    {
+      slab_destroy (c, list_entry (list_pop_front (&c->empty),
+                                   struct slab, elem));
+      c->empty_cnt--;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Allocates a new slab page for cache C and runs the constructor
+   on each of its objects.  Returns a null pointer if no page is
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->used_cnt = 0;
+  s->free_top = c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      /* Hand out slots in address order. */
+      s->free_idx[i] = c->objs_per_slab - 1 - i;
+      if (c->ctor != NULL)
+        c->ctor (slab_to_obj (c, s, i));
+    }
+
+  c->slab_cnt++;
+  c->grow_cnt++;
+  return s;
+}
+
+/* Returns slab S, which has no objects in use, to the page
+   allocator.  C's lock must be held. */
+static void
+slab_destroy (struct kmem_cache *c, struct slab *s)
+{
+  ASSERT (s->used_cnt == 0);
+
+  s->magic = 0;
+  palloc_free_page (s);
+  c->slab_cnt--;
+  c->reclaim_cnt++;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object within slab S of cache C. */
+static void *
+slab_to_obj (struct kmem_cache *c, struct slab *s, size_t idx)
+{
+  ASSERT (idx < c->objs_per_slab);
+  return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
@@ -0,0 +1,28 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches for fixed-size kernel objects.
+
+   Each cache hands out slots of exactly its object size (rounded
+   up to pointer alignment) from single pages ("slabs") obtained
+   from the page allocator.  See slab.c for details. */
+
+struct kmem_cache;
+
+/* Optional constructor, run once on each object when its slab
+   is created.  Objects must be returned to the cache in their
+   constructed state. */
+typedef void kmem_ctor_func (void *obj);
+
+void slab_init (void);
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+size_t kmem_cache_shrink (struct kmem_cache *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
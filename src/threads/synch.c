@@ -204,7 +204,10 @@ void lock_acquire(struct lock *lock)
   ASSERT(!intr_context());
   ASSERT(!lock_held_by_current_thread(lock));
   struct thread *cur = thread_current();
+  enum intr_level old_level;
 
+  /* holder를 확인한 뒤 donation 도중 lock이 해제되지 않도록 Interrupt를 끄고 진행 */
+  old_level = intr_disable();
   // lock holder가 존재하면, donate priority 실행
   if (lock->holder && !thread_mlfqs)
     donate_priority(lock);
@@ -213,6 +216,7 @@ void lock_acquire(struct lock *lock)
 
   cur->waiting_lock = NULL;
   lock->holder = cur;
+  intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -241,13 +245,18 @@ bool lock_try_acquire(struct lock *lock)
    handler. */
 void lock_release(struct lock *lock)
 {
+  enum intr_level old_level;
+
   ASSERT(lock != NULL);
   ASSERT(lock_held_by_current_thread(lock));
 
+  /* 다른 스레드가 donor_list에 추가하는 도중에 순회하지 않도록 Interrupt를 끄고 진행 */
+  old_level = intr_disable();
   if (!thread_mlfqs)
     recover_priority(lock);
 
   lock->holder = NULL;
+  intr_set_level(old_level);
   sema_up(&lock->semaphore);
 }
 
@@ -376,6 +385,8 @@ void donate_priority(struct lock *lock)
     if (!current->waiting_lock)
       break;
     holder = current->waiting_lock->holder;
+    if (holder == NULL) // 이미 해제되어 깨어나기를 기다리는 중
+      break;
     holder->priority = current->priority;
     current = holder;
   }
@@ -0,0 +1,10 @@
+#ifndef THREADS_TEST_H
+#define THREADS_TEST_H
+
+/* Entry point of an internal test in tests/internal.  One such
+   test is linked into the kernel when it is built with
+   "make INTERNAL_TEST=NAME", and the "internal" action runs it.
+   See Makefile.build. */
+void test (void);
+
+#endif /* threads/test.h */
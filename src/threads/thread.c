@@ -192,15 +192,16 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  /* Add to run queue. */
-  thread_unblock(t);
-
+  /* fork()로 생성된 자식은 시작하자마자 fd_table을 복제하므로 실행 전에 할당 */
   t->fd_table = palloc_get_page(PAL_ZERO);
   if (t->fd_table == NULL)
   {
     return TID_ERROR;
   }
 
+  /* Add to run queue. */
+  thread_unblock(t);
+
   check_priority_for_yield(); // 우선순위 확인
 
   return tid;
@@ -656,19 +657,27 @@ bool compare_donation_priority(const struct list_elem *a, const struct list_elem
 
 void check_priority_for_yield(void)
 {
+  enum intr_level old_level;
+  bool yield = false;
+
+  /* 비교 도중 선점되면 ready_list가 비어 있을 수 있으므로 Interrupt를 끄고 확인 */
+  old_level = intr_disable();
   // Compare the priority of Current Thread with the highest priorities of Ready List
   if (!list_empty(&ready_list))
   {
     struct thread *current_thread = thread_current();
     struct thread *highest_thread = list_entry(list_front(&ready_list), struct thread, elem);
 
-    if (current_thread->priority < highest_thread->priority)
-    {
-      if (intr_context())
-        intr_yield_on_return();
-      else
-        thread_yield();
-    }
+    yield = current_thread->priority < highest_thread->priority;
+  }
+  intr_set_level(old_level);
+
+  if (yield)
+  {
+    if (intr_context())
+      intr_yield_on_return();
+    else
+      thread_yield();
   }
 }
 
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include "threads/synch.h"
 #include "lib/kernel/hash.h"
+#include "vm/vma.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -125,7 +126,7 @@ struct thread
 #endif
 
    /*Project 3*/
-   struct hash spt;  // S-page table
+   struct spt spt;   // S-page table (가상 메모리 영역 + 페이지별 entry)
    void *esp;        // save Stack pointer
    struct hash mmt;
    int mapid;
@@ -157,7 +157,8 @@ static void page_fault(struct intr_frame *f)
             c. stack overflow
                - static void vm_stack_growth(void *addr)
       2. Write 권한 없는 페이지에 write 시도한 경우 (Writing r/o)
-         (!not_present인 경우) : 잘못된 접근
+         (!not_present인 경우) : 공유 zero frame, fork로 공유 중인 프레임에 대한 write면
+         copy-on-write, 그 외는 잘못된 접근
       3. Invalid address에 접근한 경우
          조건 : NULL이거나, is_kernel_vaddr()이거나 spt에도 없는 경우(is_exist_spt(adrr))
    */
@@ -165,15 +166,19 @@ static void page_fault(struct intr_frame *f)
    void *esp = user ? f->esp : cur->esp;
    void *upage = pg_round_down(fault_addr);
 
-   if (is_kernel_vaddr(fault_addr) || !not_present)
-   {
-      if (lock_held_by_current_thread(&frame_lock))
-      {
-         lock_release(&frame_lock);
-      }
+   if (is_kernel_vaddr(fault_addr))
       exit(-1);
+
+   /* 읽기 전용 페이지에 대한 write : 공유 zero frame이나 fork로 공유 중인 프레임이 매핑된
+      페이지면 private frame으로 교체 (copy-on-write), 그 외(실행 파일의 읽기 전용 페이지 등)는 잘못된 접근 */
+   if (!not_present)
+   {
+      struct spt_entry *entry = spt_find_page(&cur->spt, fault_addr);
+
+      if (!write || !(zero_page_write(entry, cur) || cow_page_write(entry, cur)))
+         exit(-1);
+      return;
    }
-   lock_acquire(&frame_lock);
 
    struct spt_entry *entry = spt_find_page(&cur->spt, fault_addr);
    if (entry == NULL)
@@ -181,18 +186,48 @@ static void page_fault(struct intr_frame *f)
       if (is_stack_access(esp, fault_addr))
          entry = grow_stack(esp, fault_addr, cur);
       else
-      {
-         lock_release(&frame_lock);
          exit(-1);
-      }     
    }
-   void *kpage = frame_allocate(PAL_USER, upage);
-   page_load(entry, kpage);
-   map_page(entry, upage, kpage, cur);
-   if(lock_held_by_current_thread(&frame_lock)) {
-      lock_release(&frame_lock);
+
+   /* 해당 페이지가 evict I/O 중이면 완료될 때까지 대기.
+      frame_lock은 대기하는 동안만 잡으며, 디스크 I/O(page_load) 중에는 잡지 않으므로
+      다른 페이지의 fault는 동시에 처리될 수 있음 */
+   lock_acquire(&frame_lock);
+   frame_wait_eviction(entry);
+   lock_release(&frame_lock);
+
+   /* 큰 영역(4MB 이상)의 첫 fault는 영역 전체를 large page 하나로 매핑.
+      0으로 초기화된 페이지는 읽기만 하는 경우가 많으므로 write fault일 때만 시도 */
+   if ((entry->status == PAGE_FILE || (write && entry->status == PAGE_ZERO))
+       && map_large_page(entry, cur))
+      return;
+
+   /* 0으로 초기화된 페이지(BSS, 스택)의 읽기는 프레임 없이 공유 zero frame으로 처리 */
+   if (!write && entry->status == PAGE_ZERO)
+   {
+      map_zero_page(entry, cur);
+      return;
+   }
+
+   /* 새 프레임은 로드와 매핑이 끝날 때까지 pinned 상태 */
+   bool file_fault = entry->status == PAGE_FILE;
+   bool swap_fault = entry->status == PAGE_SWAP;
+   size_t swap_slot = entry->swap_index;
+   void *kpage = frame_allocate(PAL_USER, entry);
+   if (!page_load(entry, kpage))
+   {
+      frame_deallocate(kpage);
+      exit(-1);
    }
-      
+   map_page(entry, upage, kpage, cur);
+   frame_unpin(kpage);
+
+   /* 실행 파일, mmap 페이지는 주변 페이지도 함께 로드 */
+   if (file_fault)
+      fault_around(entry, cur);
+   /* swap된 페이지는 연속된 slot에 있는 다음 페이지들도 함께 읽음 */
+   else if (swap_fault)
+      swap_readahead(entry, swap_slot, cur);
 }
 
 bool is_stack_access(void *esp, void *fault_addr)
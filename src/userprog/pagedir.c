@@ -1,13 +1,51 @@
 #include "userprog/pagedir.h"
+#include <list.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/thread.h"
+
+/* Maximum number of pages a TLB batch flushes one at a time.
+   Beyond this, reloading CR3 is cheaper than more INVLPGs. */
+#define TLB_BATCH_MAX 32
+
+/* Deferred TLB invalidations of the active page directory.  Only
+   the thread that opened the batch defers; see
+   pagedir_tlb_batch_begin(). */
+static struct thread *batch_owner;          /* Batching thread, or null. */
+static const void *batch_pages[TLB_BATCH_MAX]; /* Pages to invalidate. */
+static size_t batch_cnt;                    /* Entries in BATCH_PAGES. */
+static bool batch_full;                     /* Too many: flush all. */
+
+/* A page table set aside when a 4 MB page is mapped, so that
+   splitting the 4 MB page never has to allocate memory.  Until
+   the split, the start of the page table's page holds this
+   bookkeeping instead of PTEs. */
+struct reserved_pt
+  {
+    struct list_elem elem;                  /* Element in RESERVED_PTS. */
+    uint32_t *pde;                          /* PDE of the 4 MB page. */
+  };
+
+/* Reserved page tables of all mapped 4 MB pages.  Accessed with
+   interrupts off. */
+static struct list reserved_pts = LIST_INITIALIZER (reserved_pts);
+
+/* Large page statistics. */
+static unsigned long long large_cnt;        /* 4 MB pages mapped. */
+static unsigned long long split_cnt;        /* 4 MB pages split. */
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static uint32_t *lookup_large (uint32_t *pd, const void *vaddr);
+static void split_large (uint32_t *pd, uint32_t *pde);
+static uint32_t *take_reserved_pt (uint32_t *pde);
+static void invalidate_page (uint32_t *, const void *);
+static void invlpg (const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -22,7 +60,10 @@ uint32_t * pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  The frames of 4 MB pages are not freed here: their
+   owner releases them page by page, without unmapping (see
+   spt_destructor()), and the whole 4 MB page is unmapped here at
+   once, freeing the page table reserved for splitting it. */
 void pagedir_destroy (uint32_t *pd) 
 {
   uint32_t *pde;
@@ -32,7 +73,9 @@ void pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if ((*pde & PTE_P) && pde_is_large (*pde))
+      palloc_free_page (take_reserved_pt (pde));
+    else if (*pde & PTE_P)
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -50,7 +93,10 @@ void pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR lies in a 4 MB page, the 4 MB page is split into 4 kB
+   pages first, so that the returned PTE can be changed on its
+   own. */
 static uint32_t * lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
   uint32_t *pt, *pde;
@@ -76,6 +122,8 @@ static uint32_t * lookup_page (uint32_t *pd, const void *vaddr, bool create)
       else
         return NULL;
     }
+  else if (pde_is_large (*pde))
+    split_large (pd, pde);
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -120,6 +168,11 @@ bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
    UADDR is unmapped. */
 void * pagedir_get_page (uint32_t *pd, const void *uaddr) 
 {
+  uint32_t *pde = lookup_large (pd, uaddr);
+  if (pde != NULL)
+    return (uint8_t *) ptov (*pde & ~(uint32_t) (PTSPAN - 1))
+           + ((uintptr_t) uaddr & (PTSPAN - 1));
+
   uint32_t *pte;
 
   ASSERT (is_user_vaddr (uaddr));
@@ -147,7 +200,7 @@ void pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -157,7 +210,9 @@ void pagedir_clear_page (uint32_t *pd, void *upage)
    Returns false if PD contains no PTE for VPAGE. */
 bool pagedir_is_dirty (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -173,18 +228,37 @@ void pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  Used to write-protect pages shared copy-on-write
+   after fork() and to lift the protection once they are private
+   again. */
+void pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_page (pd, vpage);
+    }
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
    PD contains no PTE for VPAGE. */
 bool pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -200,11 +274,70 @@ void pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Returns true if VADDR lies in a 4 MB page in PD. */
+bool pagedir_is_large (uint32_t *pd, const void *vaddr) 
+{
+  return lookup_large (pd, vaddr) != NULL;
+}
+
+/* Returns true if the 4 MB region of user virtual memory that
+   starts at UPAGE may be mapped with pagedir_set_large_page():
+   the CPU supports 4 MB pages, UPAGE is 4 MB aligned, and no page
+   in the region is mapped in PD yet. */
+bool pagedir_can_map_large (uint32_t *pd, const void *upage) 
+{
+  return (init_large_pages
+          && (uintptr_t) upage % PTSPAN == 0
+          && is_user_vaddr (upage)
+          && pd[pd_no (upage)] == 0);
+}
+
+/* Maps the 4 MB region of user virtual memory that starts at
+   UPAGE in PD to the physically contiguous, 4 MB aligned frames
+   that start at KPAGE, with a single PDE.  If WRITABLE is true,
+   the region is read/write; otherwise it is read-only.  The
+   region must satisfy pagedir_can_map_large().
+
+   The whole region then shares one accessed and one dirty bit.
+   Any later change to the mapping of a single page in it splits
+   the 4 MB page back into 4 kB pages (see split_large()).  The
+   page table for that is allocated here and kept until then.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                             bool writable) 
+{
+  struct reserved_pt *r;
+  enum intr_level old_level;
+
+  ASSERT (pagedir_can_map_large (pd, upage));
+  ASSERT (pd != init_page_dir);
+
+  r = palloc_get_page (0);
+  if (r == NULL)
+    return false;
+  r->pde = &pd[pd_no (upage)];
+  old_level = intr_disable ();
+  list_push_back (&reserved_pts, &r->elem);
+  intr_set_level (old_level);
+
+  *r->pde = pde_create_large (kpage, writable);
+  large_cnt++;
+  return true;
+}
+
+/* Prints large page statistics. */
+void pagedir_print_stats (void) 
+{
+  printf ("Pagedir: %llu 4 MB pages mapped, %llu split\n",
+          large_cnt, split_cnt);
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void pagedir_activate (uint32_t *pd) 
@@ -220,6 +353,54 @@ void pagedir_activate (uint32_t *pd)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
+/* Starts deferring TLB invalidations made by the current thread,
+   so that a loop that changes many PTEs, such as the clock scan
+   clearing accessed bits, flushes the TLB once at the end instead
+   of once per PTE.  Until pagedir_tlb_batch_end(), the current
+   thread must not rely on a changed PTE taking effect: that is
+   fine for accessed and dirty bits, which the CPU merely fails to
+   update through a stale entry, but not for unmapping a page
+   that the thread may still touch.
+
+   Batches do not nest.  If another thread already has a batch
+   open, the current thread's invalidations simply stay
+   immediate. */
+void
+pagedir_tlb_batch_begin (void)
+{
+  enum intr_level old_level = intr_disable ();
+  ASSERT (batch_owner != thread_current ());
+  if (batch_owner == NULL)
+    {
+      batch_owner = thread_current ();
+      batch_cnt = 0;
+      batch_full = false;
+    }
+  intr_set_level (old_level);
+}
+
+/* Ends the current thread's TLB batch and performs the deferred
+   invalidations: one INVLPG per page, or a single CR3 reload if
+   there were more than TLB_BATCH_MAX of them.  Does nothing if
+   the current thread did not get a batch. */
+void
+pagedir_tlb_batch_end (void)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t i;
+
+  if (batch_owner == thread_current ())
+    {
+      if (batch_full)
+        pagedir_activate (active_pd ());
+      else
+        for (i = 0; i < batch_cnt; i++)
+          invlpg (batch_pages[i]);
+      batch_owner = NULL;
+    }
+  intr_set_level (old_level);
+}
+
 /* Returns the currently active page directory. */
 static uint32_t * active_pd (void) 
 {
@@ -232,20 +413,98 @@ static uint32_t * active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Returns the PDE in PD that maps VADDR as part of a 4 MB page,
+   or a null pointer if VADDR is not in a 4 MB page. */
+static uint32_t * lookup_large (uint32_t *pd, const void *vaddr) 
+{
+  uint32_t *pde = pd + pd_no (vaddr);
+  return (*pde & PTE_P) && pde_is_large (*pde) ? pde : NULL;
+}
+
+/* Replaces the 4 MB page mapped by PDE, an entry in PD, with a
+   page table of 1024 PTEs that map the same frames with the same
+   permissions.  Each PTE inherits the accessed and dirty bits of
+   the 4 MB page, so no modification is lost.
+
+   Splitting happens when a single page of the region must change
+   on its own, that is, under memory pressure when the
+   replacement policy clears accessed bits or evicts a page, on
+   fork, and when part of the region is unmapped.  It uses the
+   page table reserved by pagedir_set_large_page(), so it never
+   allocates memory. */
+static void split_large (uint32_t *pd, uint32_t *pde) 
+{
+  uint32_t *pt = take_reserved_pt (pde);
+  uint32_t flags = *pde & (PTE_U | PTE_W | PTE_A | PTE_D | PTE_P);
+  uint32_t paddr = *pde & ~(uint32_t) (PTSPAN - 1);
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = (paddr + i * PGSIZE) | flags;
+  *pde = pde_create (pt);
+  split_cnt++;
+
+  /* One INVLPG drops the TLB entry of the whole 4 MB page. */
+  invalidate_page (pd, (void *) ((pde - pd) << PDSHIFT));
+}
+
+/* Removes the page table reserved for the 4 MB page mapped by
+   PDE from RESERVED_PTS and returns it. */
+static uint32_t * take_reserved_pt (uint32_t *pde) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
+  for (e = list_begin (&reserved_pts); e != list_end (&reserved_pts);
+       e = list_next (e))
+    {
+      struct reserved_pt *r = list_entry (e, struct reserved_pt, elem);
+      if (r->pde == pde)
+        {
+          list_remove (e);
+          intr_set_level (old_level);
+          return (uint32_t *) r;
+        }
+    }
+  NOT_REACHED ();
+}
+
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the changed page.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
-static void invalidate_pagedir (uint32_t *pd) 
+   This function invalidates VADDR's TLB entry if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything: switching to it reloads CR3, which flushes the TLB.)
+   Inside the current thread's TLB batch, the invalidation is
+   recorded and performed by pagedir_tlb_batch_end(). */
+static void invalidate_page (uint32_t *pd, const void *vaddr) 
 {
-  if (active_pd () == pd) 
+  enum intr_level old_level;
+
+  if (active_pd () != pd)
+    return;
+
+  old_level = intr_disable ();
+  if (batch_owner == thread_current ())
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+      if (batch_cnt < TLB_BATCH_MAX)
+        batch_pages[batch_cnt++] = vaddr;
+      else
+        batch_full = true;
+    }
+  else
+    invlpg (vaddr);
+  intr_set_level (old_level);
+}
+
+/* Removes the TLB entry for the page containing VADDR, leaving
+   the rest of the TLB intact.  See [IA32-v2a] "INVLPG--Invalidate
+   TLB Entry" and [IA32-v3a] 3.12 "Translation Lookaside Buffers
+   (TLBs)". */
+static void invlpg (const void *vaddr) 
+{
+  asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
@@ -11,8 +11,16 @@ void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
+void pagedir_set_writable (uint32_t *pd, const void *upage, bool writable);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+bool pagedir_is_large (uint32_t *pd, const void *vaddr);
+bool pagedir_can_map_large (uint32_t *pd, const void *upage);
+bool pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                             bool writable);
 void pagedir_activate (uint32_t *pd);
+void pagedir_tlb_batch_begin (void);
+void pagedir_tlb_batch_end (void);
+void pagedir_print_stats (void);
 
 #endif /* userprog/pagedir.h */
@@ -21,12 +21,18 @@
 #include "vm/frame.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 
 #define MAX_STACK_SIZE (8 * 1024 * 1024)
+#define FAULT_AROUND_PAGES 8 /* Fault-around window 크기 (pages, 2의 거듭제곱) */
+#define SWAP_READAHEAD_PAGES 4 /* Swap-in read-ahead 최대 페이지 수 */
 
 struct lock file_lock;
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static bool fork_files(struct thread *parent, struct thread *cur);
+static void mmap_write_back(struct thread *cur);
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 
 struct thread *get_child_thread(struct thread *parent, tid_t tid)
@@ -87,6 +93,41 @@ tid_t process_execute(const char *file_name)
   return tid;
 }
 
+/* fork()에서 자식 스레드에게 전달하는 정보.
+   자식이 복제를 마칠 때까지 부모는 대기하므로 부모의 스택에 둠 */
+struct fork_args
+{
+  struct thread *parent;
+  struct intr_frame *if_; // syscall 진입 시 부모의 user context
+};
+
+/* 현재 프로세스를 복제한 자식 프로세스를 만들고 그 thread id를 반환 (실패 시 TID_ERROR).
+   자식은 ELF를 다시 load()하지 않고 부모의 주소 공간을 copy-on-write로 공유 (spt_fork() 참고).
+   자식에서는 fork()가 0을 반환.
+   열린 fd는 자식에서 다시 열기 때문에 file offset은 부모와 공유되지 않음 (fork_files() 참고) */
+tid_t process_fork(struct intr_frame *if_)
+{
+  struct thread *parent = thread_current();
+  struct fork_args args = {parent, if_};
+  tid_t tid;
+
+  /* 자식은 mmap 파일을 다시 읽으므로 부모가 수정한 내용을 먼저 파일에 반영 */
+  mmap_write_back(parent);
+
+  tid = thread_create(parent->name, PRI_DEFAULT, start_fork, &args);
+  struct thread *child = get_child_thread(parent, tid);
+
+  if (tid == TID_ERROR || child == NULL)
+    return TID_ERROR;
+
+  sema_down(&child->wait_sys); // 복제가 끝날 때까지 대기
+
+  if (child->exit_flag)
+    tid = TID_ERROR;
+
+  return tid;
+}
+
 void argument_passing(char **argv, int argc, void **esp)
 {
   char *arg_stack_addr[64];
@@ -194,6 +235,125 @@ static void start_process(void *file_name_)
   NOT_REACHED();
 }
 
+/* fork()로 생성된 자식 프로세스의 시작 함수 : 부모의 파일과 주소 공간을 복제한 뒤
+   부모의 syscall 직후 지점에서 user 모드로 복귀 */
+static void start_fork(void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *cur = thread_current();
+  struct thread *parent = args->parent;
+  struct intr_frame if_ = *args->if_; // 부모가 깨어나면 args는 사라지므로 먼저 복사
+  bool success;
+
+  /* [Project 3] */
+  spt_init(&cur->spt);
+  mmt_init(&cur->mmt);
+  cur->mapid = parent->mapid;
+  cur->esp = parent->esp;
+
+  cur->pagedir = pagedir_create();
+  success = cur->pagedir != NULL;
+  if (success)
+  {
+    process_activate();
+    success = fork_files(parent, cur) && spt_fork(parent, cur->excute_file_name);
+  }
+
+  /* 복제 성공 여부 저장 및 Parent thread 깨우기 */
+  cur->exit_flag = !success;
+  sema_up(&cur->wait_sys);
+
+  if (!success)
+    thread_exit();
+
+  if_.eax = 0; // 자식의 fork() 반환값
+  asm volatile("movl %0, %%esp; jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED();
+}
+
+/* fork : 부모의 실행 파일, file descriptor table, mmap table을 복제.
+   파일은 각각 file_reopen()으로 다시 열며 offset과 쓰기 금지 여부를 이어받음.
+   UNIX의 fork와 달리 struct file을 공유하지 않으므로, fork 이후 부모와 자식의 offset은 따로 움직임.
+   mmap 페이지는 자식의 SPT에 PAGE_FILE로 추가됨 */
+static bool fork_files(struct thread *parent, struct thread *cur)
+{
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire(&file_lock);
+  if (parent->excute_file_name != NULL)
+  {
+    cur->excute_file_name = file_reopen(parent->excute_file_name);
+    if (cur->excute_file_name == NULL)
+      success = false;
+    else
+      file_deny_write(cur->excute_file_name);
+  }
+
+  for (int fd = 2; success && fd < MAX_FD; fd++)
+  {
+    struct file *file = parent->fd_table[fd];
+
+    if (file == NULL)
+      continue;
+    cur->fd_table[fd] = file_reopen(file);
+    if (cur->fd_table[fd] == NULL)
+    {
+      success = false;
+      break;
+    }
+    file_seek(cur->fd_table[fd], file_tell(file));
+    if (get_deny_write(file))
+      file_deny_write(cur->fd_table[fd]);
+  }
+
+  hash_first(&i, &parent->mmt);
+  while (success && hash_next(&i))
+  {
+    struct mmt_entry *entry = hash_entry(hash_cur(&i), struct mmt_entry, hash_elem);
+    struct file *file = file_reopen(entry->file);
+
+    if (file == NULL || !mmt_add_page(&cur->mmt, entry->mmap_id, file, entry->upage))
+    {
+      file_close(file);
+      success = false;
+    }
+  }
+  lock_release(&file_lock);
+  return success;
+}
+
+/* CUR의 mmap 페이지 중 메모리에 있는 dirty 페이지를 파일에 write-back (매핑은 유지) */
+static void mmap_write_back(struct thread *cur)
+{
+  struct hash_iterator i;
+
+  hash_first(&i, &cur->mmt);
+  while (hash_next(&i))
+  {
+    struct mmt_entry *entry = hash_entry(hash_cur(&i), struct mmt_entry, hash_elem);
+    off_t size = file_length(entry->file);
+    uint8_t *upage = entry->upage;
+
+    for (off_t ofs = 0; ofs < size; ofs += PGSIZE, upage += PGSIZE)
+    {
+      struct spt_entry *spte = spt_lookup_page(&cur->spt, upage);
+      void *kpage = spte != NULL ? frame_pin_page(spte) : NULL;
+
+      if (kpage == NULL)
+        continue;
+      if (pagedir_is_dirty(cur->pagedir, upage))
+      {
+        lock_acquire(&file_lock);
+        file_write_at(spte->file, kpage, spte->page_read_bytes, spte->ofs);
+        lock_release(&file_lock);
+        pagedir_set_dirty(cur->pagedir, upage, false);
+      }
+      frame_unpin(kpage);
+    }
+  }
+}
+
 /* Waits for thread TID to die and returns its exit status.
    If it was terminated by the kernel (i.e. killed due to an exception), returns -1.
    If TID is invalid or if it was not a child of the calling process,
@@ -245,9 +405,7 @@ void process_exit(void)
   /* Project3 */
   for (int i = 0; i < cur->mapid; i++)
     munmap(i);      
-  lock_acquire(&frame_lock);
   spt_destroy(&cur->spt);
-  lock_release(&frame_lock);
   
   
   /* Destroy the current process's page directory and switch back
@@ -368,7 +526,8 @@ static bool install_page(void *upage, void *kpage, bool writable);
 /* For Project 3 */
 static void page_zero(void *kpage);
 static void page_swap(struct spt_entry *entry, void *kpage);
-static void page_file(struct spt_entry *entry, void *kpage);
+static bool page_file(struct spt_entry *entry, void *kpage);
+static void remove_created_pages(struct thread *cur, uint8_t *start, const uint32_t created[]);
 
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
@@ -485,31 +644,29 @@ done:
 /* Create a minimal stack by mapping a zeroed page at the top of user virtual memory. */
 static bool setup_stack(void **esp)
 {
-  lock_acquire(&frame_lock);
+  struct thread *cur = thread_current();
+  uint8_t *upage = ((uint8_t *)PHYS_BASE) - PGSIZE;
+
+  // SPT에 스택 페이지 정보 추가 (Frame Table이 SPT entry를 참조하므로 먼저 추가)
+  if (!spt_add_page(&cur->spt, upage, NULL, 0, 0, PGSIZE, true, PAGE_ZERO))
+    return false;
+  struct spt_entry *entry = spt_find_page(&cur->spt, upage);
 
-  uint8_t *kpage = frame_allocate(PAL_USER | PAL_ZERO, (uint8_t *)PHYS_BASE - PGSIZE);
+  uint8_t *kpage = frame_allocate(PAL_USER | PAL_ZERO, entry);
   if (!kpage) {
-    lock_release(&frame_lock);
+    spt_remove_page(&cur->spt, upage);
     return false;
   }
   
-  if(!install_page(((uint8_t *)PHYS_BASE) - PGSIZE, kpage, true)){
-    lock_release(&frame_lock);
-    frame_deallocate(kpage);
-    return false;
-  }
-
-  // SPT에 스택 페이지 정보 추가
-  struct thread *cur = thread_current();
-  if (!spt_add_page(&cur->spt, ((uint8_t *)PHYS_BASE) - PGSIZE, NULL, 0, 0, PGSIZE, true, PAGE_PRESENT)){
-    install_page(((uint8_t *)PHYS_BASE) - PGSIZE, NULL, false); // Rollback SPT when fail
-    lock_release(&frame_lock);
+  if(!install_page(upage, kpage, true)){
     frame_deallocate(kpage);
+    spt_remove_page(&cur->spt, upage); // Rollback SPT when fail
     return false;
   }
+  entry->status = PAGE_PRESENT;
+  frame_unpin(kpage);
 
   *esp = PHYS_BASE;
-  lock_release(&frame_lock);
   return true;
 }
 
@@ -577,36 +734,9 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage, uint32_t
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
 
-  file_seek(file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0)
-  {
-    /* Calculate how to fill this page.
-       We will read PAGE_READ_BYTES bytes from FILE
-       and zero the final PAGE_ZERO_BYTES bytes. */
-    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-    size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-    /* 
-      [Lazy Load Segment 구현]
-        이 시점에서 다음과 같은 정보를 저장할 구조체를 새롭게 할당하는 방법
-          - file, ofs, page_read_bytes, page_zero_bytes를 저장 (calloc 사용하는 예시를 보는 중)
-        이후 추가적인 초기화 함수 동작
-        lazy_load_segment 구현해서 함수 포인터를 함께 전달해 초기화
-    */
-
-    /* Add SPT entry */
-    if (!spt_add_page(&thread_current()->spt, upage, file, ofs, page_read_bytes, page_zero_bytes, writable, PAGE_FILE))
-    {
-      spt_cleanup_partial(&thread_current()->spt, upage);
-      return false;
-    }
-
-    read_bytes -= page_read_bytes;
-    zero_bytes -= page_zero_bytes;
-    ofs += page_read_bytes;
-    upage += PGSIZE;
-  }
-  return true;
+  /* 세그먼트 전체를 하나의 영역으로 등록. 페이지별 SPT entry는 처음 접근(fault)할 때
+     영역 정보로부터 만들어지며, 파일에서 읽을 내용이 없는 BSS 페이지는 PAGE_ZERO가 됨 */
+  return vma_add(&thread_current()->spt, upage, read_bytes + zero_bytes, file, ofs, read_bytes, writable, VMA_EXEC);
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -634,27 +764,30 @@ struct spt_entry *grow_stack(void *esp, void *fault_addr, struct thread *cur)
   return spt_find_page(&cur->spt, upage);
 }
 
-void page_load(struct spt_entry *entry, void *kpage)
+/* ENTRY의 내용을 KPAGE에 로드. file을 끝까지 읽지 못하는 등 로드할 수 없으면 false 반환
+   (KPAGE의 반환은 호출한 쪽에서 처리) */
+bool page_load(struct spt_entry *entry, void *kpage)
 {
   switch (entry->status)
   {
   case PAGE_ZERO:
     page_zero(kpage);
-    break;
+    return true;
 
   case PAGE_SWAP:
     page_swap(entry, kpage);
-    break;
+    return true;
+
+  case PAGE_ZSWAP:
+    zswap_load(entry->swap_index, kpage);
+    entry->swap_index = -1;
+    return true;
 
   case PAGE_FILE:
-    page_file(entry, kpage);
-    break;
+    return page_file(entry, kpage);
 
   default:
-
-    lock_release(&frame_lock);
-    frame_deallocate(kpage);
-    exit(-1);
+    return false;
   }
 }
 
@@ -662,14 +795,242 @@ void map_page(struct spt_entry *entry, void *upage, void *kpage, struct thread *
 {
   if (!pagedir_set_page(cur->pagedir, upage, kpage, entry->writable))
   {
-
-    lock_release(&frame_lock);
     frame_deallocate(kpage);
     exit(-1);
   }
   entry->status = PAGE_PRESENT;
 }
 
+/* PAGE_ZERO 페이지의 읽기 fault : 프레임을 할당하지 않고 공유 zero frame을 읽기 전용으로 매핑.
+   status는 PAGE_ZERO로 유지되며, 이후 write fault는 zero_page_write()에서 처리 */
+void map_zero_page(struct spt_entry *entry, struct thread *cur)
+{
+  if (!pagedir_set_page(cur->pagedir, entry->upage, zero_frame, false))
+    exit(-1);
+}
+
+/* 공유 zero frame이 매핑된 페이지에 대한 write fault (copy-on-write) :
+   0으로 채운 private frame을 할당하여 쓰기 가능하게 다시 매핑. 처리할 수 없는 fault면 false 반환 */
+bool zero_page_write(struct spt_entry *entry, struct thread *cur)
+{
+  if (entry == NULL || entry->status != PAGE_ZERO || !entry->writable
+      || pagedir_get_page(cur->pagedir, entry->upage) != zero_frame)
+    return false;
+
+  void *kpage = frame_allocate(PAL_USER | PAL_ZERO, entry);
+  pagedir_clear_page(cur->pagedir, entry->upage);
+  map_page(entry, entry->upage, kpage, cur);
+  frame_unpin(kpage);
+  return true;
+}
+
+/* fork 후 copy-on-write로 공유 중인 페이지에 대한 write fault :
+   다른 프로세스가 아직 공유 중이면 내용을 복사한 private frame으로 교체하고,
+   더 이상 공유 중이 아니면 기존 프레임을 쓰기 가능하게 변경. 처리할 수 없는 fault면 false 반환 */
+bool cow_page_write(struct spt_entry *entry, struct thread *cur)
+{
+  if (entry == NULL || !entry->writable)
+    return false;
+
+  void *old = frame_pin_page(entry);
+  if (old == NULL) // 그 사이 evict된 경우 : 다시 접근하면 일반 page fault로 처리됨
+    return true;
+
+  lock_acquire(&frame_lock);
+  bool shared = frame_is_shared(old);
+  lock_release(&frame_lock);
+
+  if (!shared)
+  {
+    pagedir_set_writable(cur->pagedir, entry->upage, true);
+    frame_unpin(old);
+    return true;
+  }
+
+  void *kpage = frame_allocate(PAL_USER, entry);
+  memcpy(kpage, old, PGSIZE);
+
+  /* 공유 프레임에서 이 페이지의 매핑을 제거 (다른 프로세스가 모두 떠났으면 반환됨) */
+  lock_acquire(&frame_lock);
+  pagedir_clear_page(cur->pagedir, entry->upage);
+  frame_unpin(old);
+  frame_release(old, entry);
+  lock_release(&frame_lock);
+
+  map_page(entry, entry->upage, kpage, cur);
+  frame_unpin(kpage);
+  return true;
+}
+
+/* Large page : ENTRY를 포함하는 4MB 정렬 영역 전체가 하나의 vm_area 안에 있고, 영역 안에
+   아직 매핑된 페이지가 없으며, 모든 페이지가 file에서 읽거나 0으로 채울 페이지(PAGE_FILE,
+   PAGE_ZERO)이면 4MB 연속 프레임에 영역 전체를 로드하여 PDE 하나로 매핑.
+   큰 배열, mmap 영역을 순차 접근할 때 1024번의 fault와 page table 할당이 한 번으로 줄어듦.
+   메모리가 부족해지면 교체 정책이 Reference Bit를 지우거나 페이지를 evict할 때
+   4KB 페이지로 분할됨 (pagedir.c의 split_large() 참고). 분할에 쓸 page table은
+   매핑할 때 미리 할당해 두므로 분할 자체는 메모리를 할당하지 않음.
+   매핑하면 true, 조건이 맞지 않거나 여유 프레임이 부족하면 false 반환 (4KB 페이지로 처리).
+   아직 spt_entry가 없는 페이지의 entry는 프레임을 확보한 뒤에 만들고, 도중에 포기하면 다시 제거 */
+bool map_large_page(struct spt_entry *entry, struct thread *cur)
+{
+  uint8_t *start = (uint8_t *)((uintptr_t)entry->upage & ~(PTSPAN - 1));
+  uint32_t created[FRAME_LARGE_PAGES / 32] = {0}; // 이번에 만든 spt_entry 표시
+  struct vm_area *vma;
+  uint8_t *kpage;
+  size_t i;
+
+  if (!pagedir_can_map_large(cur->pagedir, start))
+    return false;
+  vma = vma_find(&cur->spt, start);
+  if (vma == NULL || vma->end < start + PTSPAN)
+    return false;
+
+  /* 이미 spt_entry가 있는 페이지의 상태 확인 (swap된 페이지 등이 있으면 포기).
+     entry가 없는 페이지는 VMA에서 PAGE_FILE이나 PAGE_ZERO로 만들어짐 */
+  for (i = 0; i < FRAME_LARGE_PAGES; i++)
+  {
+    struct spt_entry *e = spt_lookup_page(&cur->spt, start + i * PGSIZE);
+
+    if (e != NULL && ((e->status != PAGE_FILE && e->status != PAGE_ZERO)
+                      || e->writable != vma->writable))
+      return false;
+  }
+
+  kpage = frame_try_allocate_large();
+  if (kpage == NULL)
+    return false;
+  for (i = 0; i < FRAME_LARGE_PAGES; i++)
+  {
+    if (spt_lookup_page(&cur->spt, start + i * PGSIZE) != NULL)
+      continue;
+    if (spt_find_page(&cur->spt, start + i * PGSIZE) == NULL)
+      break;
+    created[i / 32] |= (uint32_t)1 << (i % 32);
+  }
+  if (i < FRAME_LARGE_PAGES)
+  {
+    remove_created_pages(cur, start, created);
+    palloc_free_multiple(kpage, FRAME_LARGE_PAGES);
+    return false;
+  }
+
+  frame_register_large(kpage, start);
+  for (i = 0; i < FRAME_LARGE_PAGES; i++)
+    if (!page_load(spt_lookup_page(&cur->spt, start + i * PGSIZE), kpage + i * PGSIZE))
+      break;
+
+  /* 로드에 실패하거나 분할에 쓸 page table을 할당하지 못하면 1024개의 프레임과 이번에 만든
+     spt_entry를 모두 반환하고 4KB 페이지로 처리 (로드 실패는 4KB 경로에서 다시 발생하여 프로세스가 종료됨) */
+  if (i < FRAME_LARGE_PAGES || !pagedir_set_large_page(cur->pagedir, start, kpage, vma->writable))
+  {
+    for (i = 0; i < FRAME_LARGE_PAGES; i++)
+      frame_deallocate(kpage + i * PGSIZE);
+    remove_created_pages(cur, start, created);
+    return false;
+  }
+
+  lock_acquire(&frame_lock);
+  for (i = 0; i < FRAME_LARGE_PAGES; i++)
+  {
+    spt_lookup_page(&cur->spt, start + i * PGSIZE)->status = PAGE_PRESENT;
+    frame_unpin(kpage + i * PGSIZE);
+  }
+  lock_release(&frame_lock);
+  return true;
+}
+
+/* map_large_page()에서 START부터의 페이지 중 CREATED에 표시된 페이지의 spt_entry를 제거 */
+static void remove_created_pages(struct thread *cur, uint8_t *start, const uint32_t created[])
+{
+  size_t i;
+
+  for (i = 0; i < FRAME_LARGE_PAGES; i++)
+    if (created[i / 32] & ((uint32_t)1 << (i % 32)))
+      spt_remove_page(&cur->spt, start + i * PGSIZE);
+}
+
+/* Fault-around : ENTRY(PAGE_FILE)의 fault를 처리한 뒤, ENTRY를 포함하는 정렬된
+   FAULT_AROUND_PAGES 크기의 window 안에서 아직 로드되지 않은 같은 file의 PAGE_FILE
+   페이지들을 file_lock을 한 번만 잡고 함께 읽어 매핑.
+   주변 페이지는 추측성 로드이므로 여유 프레임이 있을 때만 할당하고 eviction은 유발하지 않음.
+   아직 spt_entry가 없는 페이지는 VMA로 확인하고, 실제로 매핑할 때만 entry를 만듦 */
+void fault_around(struct spt_entry *entry, struct thread *cur)
+{
+  uint8_t *start = (uint8_t *)((uintptr_t)entry->upage & ~(FAULT_AROUND_PAGES * PGSIZE - 1));
+  bool was_holding_lock = lock_held_by_current_thread(&file_lock);
+
+  if (!was_holding_lock)
+    lock_acquire(&file_lock);
+  for (int i = 0; i < FAULT_AROUND_PAGES; i++)
+  {
+    uint8_t *upage = start + i * PGSIZE;
+    struct spt_entry *near = spt_lookup_page(&cur->spt, upage);
+    bool created = false;
+
+    if (near == NULL)
+    {
+      /* 같은 file에서 읽을 내용이 있는 페이지만 대상 (BSS 등은 접근할 때 처리) */
+      struct vm_area *vma = vma_find(&cur->spt, upage);
+
+      if (vma == NULL || vma->file != entry->file || (size_t)(upage - vma->start) >= vma->read_bytes)
+        continue;
+      near = spt_find_page(&cur->spt, upage);
+      if (near == NULL)
+        break;
+      created = true;
+    }
+    if (near == entry || near->status != PAGE_FILE || near->file != entry->file)
+      continue;
+
+    void *kpage = frame_try_allocate(PAL_USER, near);
+    if (kpage == NULL || file_read_at(near->file, kpage, near->page_read_bytes, near->ofs) != (int)near->page_read_bytes
+        || !pagedir_set_page(cur->pagedir, upage, kpage, near->writable))
+    { // 여유 프레임 부족 등 : 더 이상 미리 읽지 않음
+      frame_deallocate(kpage);
+      if (created)
+        spt_remove_page(&cur->spt, upage);
+      break;
+    }
+    memset(kpage + near->page_read_bytes, 0, near->page_zero_bytes);
+    near->status = PAGE_PRESENT;
+    frame_unpin(kpage);
+  }
+  if (!was_holding_lock)
+    lock_release(&file_lock);
+}
+
+/* Swap-in read-ahead : ENTRY를 swap slot SLOT에서 읽어온 뒤, 바로 다음 가상 페이지들이
+   바로 다음 slot(SLOT + 1, SLOT + 2, ...)에 swap되어 있으면 함께 읽어 매핑.
+   clustered swap-out은 이웃한 페이지를 연속된 slot에 기록하므로 순차 접근 시 fault 수가 줄어듦.
+   fault-around와 마찬가지로 여유 프레임이 있을 때만 읽으며 eviction은 유발하지 않음 */
+void swap_readahead(struct spt_entry *entry, size_t slot, struct thread *cur)
+{
+  uint8_t *upage = entry->upage;
+
+  for (int i = 1; i <= SWAP_READAHEAD_PAGES; i++)
+  {
+    upage += PGSIZE;
+    if (!is_user_vaddr(upage))
+      break;
+
+    struct spt_entry *near = spt_lookup_page(&cur->spt, upage);
+    if (near == NULL || near->status != PAGE_SWAP || near->swap_index != slot + i)
+      break;
+
+    void *kpage = frame_try_allocate(PAL_USER, near);
+    if (kpage == NULL) // 여유 프레임 부족 : 더 이상 미리 읽지 않음
+      break;
+    if (!pagedir_set_page(cur->pagedir, upage, kpage, near->writable))
+    {
+      frame_deallocate(kpage);
+      break;
+    }
+    page_swap(near, kpage);
+    near->status = PAGE_PRESENT;
+    frame_unpin(kpage);
+  }
+}
+
 static void page_zero(void *kpage)
 {
   memset(kpage, 0, PGSIZE);
@@ -681,21 +1042,19 @@ static void page_swap(struct spt_entry *entry, void *kpage)
   entry->swap_index = -1;
 }
 
-static void page_file(struct spt_entry *entry, void *kpage)
+static bool page_file(struct spt_entry *entry, void *kpage)
 {
   bool was_holding_lock = lock_held_by_current_thread(&file_lock);
+  bool success;
 
   if (!was_holding_lock)
     lock_acquire(&file_lock);
   file_seek(entry->file, entry->ofs);
-  if (file_read(entry->file, kpage, entry->page_read_bytes) != (int)entry->page_read_bytes)
-  {
-    frame_deallocate(kpage);
-    if (!was_holding_lock)
-      lock_release(&file_lock);
-    exit(-1);
-  }
-  memset(kpage + entry->page_read_bytes, 0, entry->page_zero_bytes);
+  success = file_read(entry->file, kpage, entry->page_read_bytes) == (int)entry->page_read_bytes;
   if (!was_holding_lock)
     lock_release(&file_lock);
+
+  if (success)
+    memset(kpage + entry->page_read_bytes, 0, entry->page_zero_bytes);
+  return success;
 }
@@ -1,6 +1,7 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "vm/frame.h"
 #include "vm/page.h"
@@ -9,6 +10,7 @@
 
 struct thread *get_child_thread(struct thread *parent, tid_t tid);  // Add user define function (project2)
 tid_t process_execute (const char *file_name);
+tid_t process_fork (struct intr_frame *if_);
 void  argument_passing(char **argv, int argc, void **esp);          // Add new passing function (project2)
 int   process_wait (tid_t);
 void  process_exit (void);
@@ -16,7 +18,13 @@ void  process_activate (void);
 
 /* For project 3 */
 struct spt_entry *grow_stack(void *esp, void *fault_addr, struct thread *cur);
-void page_load(struct spt_entry *entry, void *kpage);
+bool page_load(struct spt_entry *entry, void *kpage);
 void map_page(struct spt_entry *entry, void *upage, void *kpage, struct thread *cur);
+void map_zero_page(struct spt_entry *entry, struct thread *cur);
+bool zero_page_write(struct spt_entry *entry, struct thread *cur);
+bool cow_page_write(struct spt_entry *entry, struct thread *cur);
+bool map_large_page(struct spt_entry *entry, struct thread *cur);
+void fault_around(struct spt_entry *entry, struct thread *cur);
+void swap_readahead(struct spt_entry *entry, size_t slot, struct thread *cur);
 
 #endif /* userprog/process.h */
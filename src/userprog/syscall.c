@@ -9,11 +9,11 @@
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "devices/shutdown.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "devices/input.h"
-
-#define MAX_FD 128  /* limit of 128 openfiles per process [Pintos Manual]*/
+#include "vm/frame.h"
 
 static void syscall_handler(struct intr_frame *f);
 
@@ -21,6 +21,8 @@ static void syscall_handler(struct intr_frame *f);
 void check_address(const void *addr);
 int find_idx_of_empty_slot(struct file *file);
 struct file *get_file_from_fd(int fd);
+static void pin_buffer(const void *buffer, unsigned size, bool write);
+static void unpin_buffer(const void *buffer, unsigned size);
 
 
 void syscall_init(void)
@@ -99,6 +101,12 @@ static void syscall_handler(struct intr_frame *f)
     case SYS_MUNMAP:
       munmap(*(mapid_t *)(f->esp + 4));
       break;
+    case SYS_FORK:
+      f->eax = process_fork(f);
+      break;
+    case SYS_SYNC:
+      sync();
+      break;
     default:
       printf("Not Defined system call!\n");
   }
@@ -149,10 +157,13 @@ bool create(const char *file, unsigned initial_size)
 {
   check_address(file);
   bool result;
+  unsigned len = strlen(file) + 1;
 
+  pin_buffer(file, len, false);
   lock_acquire(&file_lock);
   result = filesys_create(file, initial_size);
   lock_release(&file_lock);
+  unpin_buffer(file, len);
   
   return result;
 }
@@ -161,11 +172,14 @@ bool remove(const char *file)
 {
   check_address(file);
   bool result;
+  unsigned len = strlen(file) + 1;
 
   // Check : 실행 중인 파일에 대해 remove하는 경우, Unix 표준 처리 방식으로 구현해야 함.
+  pin_buffer(file, len, false);
   lock_acquire(&file_lock);
   result = filesys_remove(file);
   lock_release(&file_lock);
+  unpin_buffer(file, len);
 
   return result;
 }
@@ -173,10 +187,13 @@ bool remove(const char *file)
 int open(const char *file)
 {
   check_address(file);
+  unsigned len = strlen(file) + 1;
 
+  pin_buffer(file, len, false);
   lock_acquire(&file_lock);
   struct file *f = filesys_open(file);
   lock_release(&file_lock);
+  unpin_buffer(file, len);
 
   /* NULL Check */
   if (f == NULL)
@@ -228,9 +245,11 @@ int read(int fd, void *buffer, unsigned size)
   else { /* Else part */      
     struct file *file = get_file_from_fd(fd);
     if(file != NULL){
+      pin_buffer(buffer, size, true);
       lock_acquire(&file_lock);
       count = file_read(file, buffer, size);
       lock_release(&file_lock);
+      unpin_buffer(buffer, size);
       return count;
     }
   } 
@@ -254,9 +273,11 @@ int write(int fd, const void *buffer, unsigned size)
   else {
     struct file *file = get_file_from_fd(fd);
     if(file != NULL){
+      pin_buffer(buffer, size, false);
       lock_acquire(&file_lock);
       count = file_write(file, buffer, size);
       lock_release(&file_lock);
+      unpin_buffer(buffer, size);
       return count;
     }
   }
@@ -332,25 +353,33 @@ void munmap(mapid_t mapping)
   struct spt_entry *spte;
 
 
-  lock_acquire(&file_lock);
   for (off_t ofs = 0; ofs < size; ofs += PGSIZE, upage += PGSIZE) {
-    spte = spt_find_page(&cur->spt, upage);
-    
-    //dirty인 경우 WB
-    void *kpage = pagedir_get_page(cur->pagedir, upage);
-    if (pagedir_is_dirty(cur->pagedir, upage))    
-      file_write_at(spte->file, kpage, spte-> page_read_bytes, spte->ofs);
-    
-    uint32_t *pagedir = thread_current()->pagedir;
-    if (spte->status == PAGE_PRESENT) {
-      pagedir_clear_page(pagedir, upage);
+    spte = spt_lookup_page(&cur->spt, upage);
+    if (spte == NULL) // 한 번도 접근하지 않은 페이지
+      continue;
+
+    // 메모리에 있는 페이지는 pin한 뒤 dirty인 경우 WB (evict된 페이지는 이미 write-back 됨)
+    // evict 도중의 write-back도 file_lock이 필요하므로 file_lock은 WB 동안만 잡음
+    void *kpage = frame_pin_page(spte);
+    if (kpage != NULL) {
+      if (pagedir_is_dirty(cur->pagedir, upage)) {
+        lock_acquire(&file_lock);
+        file_write_at(spte->file, kpage, spte-> page_read_bytes, spte->ofs);
+        lock_release(&file_lock);
+      }
+      pagedir_clear_page(cur->pagedir, upage);
       frame_deallocate(kpage);
     }
     spt_remove_page(&cur->spt, spte->upage);
   }
-  hash_delete(&cur->mmt, &entry->hash_elem);
-  free(entry);
-  lock_release(&file_lock);
+  vma_remove(&cur->spt, entry->upage);
+  mmt_remove_entry(&cur->mmt, entry);
+}
+
+/* 캐시의 dirty sector를 모두 disk에 기록 */
+void sync(void)
+{
+  cache_flush();
 }
 
 /* Additional user-defined functions */
@@ -362,6 +391,56 @@ void check_address(const void *addr)
   }
 }
 
+/* file_lock을 잡은 채 사용자 버퍼에서 page fault가 나면, 그 페이지를 evict 중인 스레드가
+   mmap write-back을 위해 file_lock을 기다리는 동안 fault handler는 evict 완료를 기다리게 되어
+   서로를 기다릴 수 있음. 그래서 file_lock을 잡기 전에 [BUFFER, BUFFER + SIZE)의 모든 페이지를
+   직접 접근해 적재하고 pin하여 evict되지 않게 함. WRITE면 쓰기로 접근하여 copy-on-write와
+   zero frame 교체도 미리 끝냄. 공유 zero frame은 evict되지 않으므로 pin하지 않음 */
+static void pin_buffer(const void *buffer, unsigned size, bool write)
+{
+  struct thread *cur = thread_current();
+  uint8_t *upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down(buffer); upage < (uint8_t *)buffer + size; upage += PGSIZE)
+  {
+    /* 스택 확장 조건(esp 근처)을 만족하도록 버퍼 안의 주소로 접근 */
+    volatile uint8_t *addr = upage < (uint8_t *)buffer ? (uint8_t *)buffer : upage;
+
+    if (!is_user_vaddr(upage))
+      exit(-1);
+    for (;;)
+    {
+      if (write)
+        *addr = *addr;
+      else
+        (void)*addr;
+      /* 접근한 뒤 pin하기 전에 evict되었으면 다시 접근 */
+      if (frame_pin_page(spt_lookup_page(&cur->spt, upage)) != NULL
+          || pagedir_get_page(cur->pagedir, upage) == zero_frame)
+        break;
+    }
+  }
+}
+
+/* pin_buffer()로 pin한 페이지들의 pin을 해제 */
+static void unpin_buffer(const void *buffer, unsigned size)
+{
+  struct thread *cur = thread_current();
+  uint8_t *upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down(buffer); upage < (uint8_t *)buffer + size; upage += PGSIZE)
+  {
+    void *kpage = pagedir_get_page(cur->pagedir, upage);
+
+    if (kpage != NULL && kpage != zero_frame)
+      frame_unpin(kpage);
+  }
+}
+
 int find_idx_of_empty_slot(struct file *file)
 {
   struct thread *cur = thread_current();
@@ -4,6 +4,8 @@
 #include "threads/synch.h"
 #include "lib/user/syscall.h"
 
+#define MAX_FD 128  /* limit of 128 openfiles per process [Pintos Manual]*/
+
 /* Process identifier. */
 extern struct lock file_lock;
 
@@ -25,5 +27,6 @@ unsigned tell(int fd);
 void close(int fd);
 mapid_t mmap(int fd, void *addr);
 void munmap(mapid_t mapping);
+void sync(void);
 
 #endif /* userprog/syscall.h */
\ No newline at end of file
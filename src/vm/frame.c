@@ -1,225 +1,501 @@
 #include "vm/frame.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
+#include "vm/policy.h"
+#include "vm/pageout.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "filesys/file.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include <stdio.h>
+#include <string.h>
+
+/* copy-on-write로 프레임을 공유하는 (owner, spte) */
+struct frame_sharer
+{
+    struct thread *owner;
+    struct spt_entry *spte;
+    struct list_elem elem;
+};
+
+/* Frame Table 전역 변수 */
+struct frame_table_entry *frame_table;
+size_t frame_table_size;
+struct list frame_list;
+struct lock frame_lock;
+void *zero_frame;
+static struct kmem_cache *sharer_cache; // struct frame_sharer
+static struct condition evict_done;   // PAGE_EVICTING 페이지의 I/O 완료를 기다리는 waiter
+static unsigned long long evict_cnt;  // Eviction 횟수 (교체 정책 비교용)
 
 /* functionality to manage frame_table */
-static bool frame_table_add_entry (void *frame, void *upage);
-static struct frame_table_entry *frame_table_find_victim (void);
-static bool swap_out_evicted_page (struct frame_table_entry *victim_entry);
+static struct frame_table_entry *frame_table_lookup (void *frame);
+static void frame_table_add_entry (void *frame, struct spt_entry *spte);
+static void frame_table_remove_entry (struct frame_table_entry *fte);
+static size_t evict_pages (struct frame_table_entry *victims[], size_t max);
+static void sort_victims (struct frame_table_entry *victims[], size_t cnt);
 
 
 void frame_table_init(void)
 {
-    list_init(&frame_table);    
+    /* user pool의 모든 프레임에 대해 entry를 미리 할당 (frame == NULL : 빈 슬롯) */
+    frame_table_size = palloc_user_pool_size();
+    frame_table = calloc(frame_table_size, sizeof *frame_table);
+    if (frame_table == NULL && frame_table_size > 0)
+        PANIC("Failed to allocate frame table!");
+    list_init(&frame_list);
     lock_init(&frame_lock);     
+    cond_init(&evict_done);
+    sharer_cache = kmem_cache_create("frame_sharer", sizeof (struct frame_sharer), NULL);
+
+    zero_frame = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 }
 
-void *frame_allocate(enum palloc_flags flags, void *upage)
+/* SPTE 페이지를 위한 프레임 할당. 반환된 프레임은 pinned 상태이므로
+   page_load()와 map_page()가 끝나면 frame_unpin()을 호출해야 함.
+   frame_lock은 frame_table 갱신 동안만 잡고, eviction I/O 동안에는 잡지 않음 */
+void *frame_allocate(enum palloc_flags flags, struct spt_entry *spte)
 {    
-    void *frame = NULL;
-    frame = palloc_get_page(flags);
-    
-    // if(frame == NULL){
-    //     if (!frame_evict()) // Eviction도 실패한 경우 NULL 반환
-    //         ASSERT(false);
-    //     frame = palloc_get_page(flags);
-    // }
-    // frame_table_add_entry(frame, upage);
-
-    if (frame != NULL) {
-        frame_table_add_entry(frame, upage);
-    }
-    else 
-    { // Frame allocation 실패 시, Evict Frame 호출       
-        if (!frame_evict()) // Eviction도 실패한 경우 NULL 반환
+    struct frame_table_entry *fte;
+    void *frame = palloc_get_page(flags);
+
+    if (frame == NULL)
+    { // Frame allocation 실패 시, victim을 evict하고 그 프레임을 재사용
+        if (evict_pages(&fte, 1) == 0) // Eviction도 실패한 경우
         {
             ASSERT(false);
         }
-        frame = palloc_get_page(flags);
-        frame_table_add_entry(frame, upage);
+        frame = fte->frame;
+        if (flags & PAL_ZERO)
+            memset(frame, 0, PGSIZE);
+
+        lock_acquire(&frame_lock);
+        fte->frame = NULL; // victim entry를 비우고 새 소유자로 다시 등록
+        list_remove(&fte->elem);
     }
-    ASSERT(frame != NULL);
+    else
+        lock_acquire(&frame_lock);
+
+    frame_table_add_entry(frame, spte);
+    pageout_check(); // 여유 프레임이 부족하면 page-out daemon을 깨움
+    lock_release(&frame_lock);
     return frame;
 }
 
+/* eviction을 유발하지 않고 여유 프레임이 충분할 때만 할당 (fault-around 등 추측성 로드용).
+   여유 프레임이 low watermark 아래면 NULL 반환. 반환된 프레임은 pinned 상태 */
+void *frame_try_allocate(enum palloc_flags flags, struct spt_entry *spte)
+{
+    void *frame;
+
+    if (pageout_low())
+        return NULL;
+    frame = palloc_get_page(flags);
+    if (frame == NULL)
+        return NULL;
+
+    lock_acquire(&frame_lock);
+    frame_table_add_entry(frame, spte);
+    lock_release(&frame_lock);
+    return frame;
+}
+
+/* Large page : 물리 주소가 4MB 정렬된 연속 프레임 FRAME_LARGE_PAGES개를 할당.
+   frame_try_allocate()와 마찬가지로 eviction을 유발하지 않으며, 할당 후에도 large page 하나
+   이상의 여유 프레임이 남을 때만 할당. 실패 시 NULL 반환.
+   반환된 프레임은 아직 frame_table에 등록되지 않았으므로, frame_register_large()로 등록하거나
+   palloc_free_multiple()로 반환해야 함 */
+void *frame_try_allocate_large(void)
+{
+    if (pageout_low() || palloc_user_free_cnt() < 2 * FRAME_LARGE_PAGES)
+        return NULL;
+    return palloc_get_aligned(PAL_USER, FRAME_LARGE_PAGES, FRAME_LARGE_PAGES);
+}
+
+/* frame_try_allocate_large()로 할당한 KPAGE의 프레임들을, UPAGE부터 이어지는 각 페이지의
+   spt_entry(미리 만들어져 있어야 함)로 frame_table에 등록.
+   프레임은 각각 독립된 frame_table entry이므로 이후 하나씩 evict, 반환될 수 있음.
+   등록된 프레임은 모두 pinned 상태 */
+void frame_register_large(void *kpage, void *upage)
+{
+    struct thread *cur = thread_current();
+    size_t i;
+
+    lock_acquire(&frame_lock);
+    for (i = 0; i < FRAME_LARGE_PAGES; i++)
+    {
+        struct spt_entry *spte = spt_lookup_page(&cur->spt, (uint8_t *)upage + i * PGSIZE);
+
+        ASSERT(spte != NULL);
+        frame_table_add_entry((uint8_t *)kpage + i * PGSIZE, spte);
+    }
+    pageout_check();
+    lock_release(&frame_lock);
+}
+
 void frame_deallocate(void *frame)
 {
-    struct frame_table_entry *fte;
+    bool was_holding_lock = lock_held_by_current_thread(&frame_lock);
+    struct frame_table_entry *fte = frame_table_lookup(frame);
+
+    if (!was_holding_lock)
+        lock_acquire(&frame_lock);
+    if (fte != NULL && fte->frame == frame)
+        frame_table_remove_entry(fte); // Frame Table에서 제거 및 물리 메모리 반환
+    if (!was_holding_lock)
+        lock_release(&frame_lock);
+}
+
+/* SPTE 페이지가 메모리에 있으면 그 프레임을 pin하여 반환, 없으면 NULL 반환.
+   evict 중이면 완료될 때까지 기다린 뒤 판단 */
+void *frame_pin_page(struct spt_entry *spte)
+{
+    void *frame = NULL;
+
+    lock_acquire(&frame_lock);
+    frame_wait_eviction(spte);
+    if (spte->status == PAGE_PRESENT)
+    {
+        frame = pagedir_get_page(thread_current()->pagedir, spte->upage);
+        struct frame_table_entry *fte = frame_table_lookup(frame);
+        ASSERT(fte != NULL && fte->frame == frame);
+        fte->pinned = true;
+    }
+    lock_release(&frame_lock);
+    return frame;
+}
+
+void frame_unpin(void *frame)
+{
+    bool was_holding_lock = lock_held_by_current_thread(&frame_lock);
+    struct frame_table_entry *fte = frame_table_lookup(frame);
+
+    ASSERT(fte != NULL && fte->frame == frame);
+    if (!was_holding_lock)
+        lock_acquire(&frame_lock);
+    fte->pinned = false;
+    if (!was_holding_lock)
+        lock_release(&frame_lock);
+}
+
+/* fork : OWNER의 SPTE도 FRAME을 copy-on-write로 매핑하도록 sharer로 추가.
+   frame_lock을 잡은 상태에서 호출 */
+bool frame_share(void *frame, struct thread *owner, struct spt_entry *spte)
+{
+    struct frame_table_entry *fte = frame_table_lookup(frame);
+    struct frame_sharer *sharer;
+
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+    ASSERT(fte != NULL && fte->frame == frame);
+
+    sharer = kmem_cache_alloc(sharer_cache);
+    if (sharer == NULL)
+        return false;
+    sharer->owner = owner;
+    sharer->spte = spte;
+    list_push_back(&fte->sharers, &sharer->elem);
+    return true;
+}
+
+/* FRAME을 둘 이상의 프로세스가 매핑하고 있는지 확인. frame_lock을 잡은 상태에서 호출 */
+bool frame_is_shared(void *frame)
+{
+    struct frame_table_entry *fte = frame_table_lookup(frame);
+
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+    ASSERT(fte != NULL && fte->frame == frame);
+    return !list_empty(&fte->sharers);
+}
+
+/* SPTE의 FRAME 매핑을 제거. 다른 프로세스가 아직 공유 중이면 프레임은 유지하고,
+   마지막 매핑이었으면 물리 메모리를 반환 */
+void frame_release(void *frame, struct spt_entry *spte)
+{
+    bool was_holding_lock = lock_held_by_current_thread(&frame_lock);
+    struct frame_table_entry *fte = frame_table_lookup(frame);
     struct list_elem *e;
 
-    // lock_acquire(&frame_lock);
-    for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))    {
-        fte = list_entry(e, struct frame_table_entry, elem);
-        if (fte->frame == frame) {
-            if (e == hand)
-                hand = list_remove(e); // Frame Table에서 제거
-            else
-                list_remove(e);
-            palloc_free_page(frame); // 물리 메모리 반환
-            free(fte);      // Frame Table Entry 해제
-            break;
+    if (!was_holding_lock)
+        lock_acquire(&frame_lock);
+    if (fte != NULL && fte->frame == frame)
+    {
+        if (fte->spte == spte && list_empty(&fte->sharers))
+            frame_table_remove_entry(fte); // Frame Table에서 제거 및 물리 메모리 반환
+        else if (fte->spte == spte)
+        { // 첫 sharer가 이 프레임의 owner가 됨
+            struct frame_sharer *sharer = list_entry(list_pop_front(&fte->sharers), struct frame_sharer, elem);
+            fte->owner = sharer->owner;
+            fte->spte = sharer->spte;
+            kmem_cache_free(sharer_cache, sharer);
         }
+        else
+            for (e = list_begin(&fte->sharers); e != list_end(&fte->sharers); e = list_next(e))
+            {
+                struct frame_sharer *sharer = list_entry(e, struct frame_sharer, elem);
+                if (sharer->spte == spte)
+                {
+                    list_remove(e);
+                    kmem_cache_free(sharer_cache, sharer);
+                    break;
+                }
+            }
     }
-    // lock_release(&frame_lock);
+    if (!was_holding_lock)
+        lock_release(&frame_lock);
 }
 
-bool frame_evict(void) 
+/* SPTE가 evict 중(PAGE_EVICTING)이면 I/O가 끝날 때까지 대기.
+   frame_lock을 잡은 상태에서 호출 */
+void frame_wait_eviction(struct spt_entry *spte)
 {
-    struct frame_table_entry *victim_entry;
-    victim_entry = frame_table_find_victim();
-    ASSERT(victim_entry != NULL);
-    return swap_out_evicted_page(victim_entry);
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    while (spte->status == PAGE_EVICTING)
+        cond_wait(&evict_done, &frame_lock);
+}
+
+/* Prints frame eviction statistics. */
+void frame_print_stats(void)
+{
+    printf("Frame: %llu evictions (%s policy)\n", evict_cnt, replace_policy->name);
+}
+
+/* 최대 CNT개의 victim을 한 번에 evict하고 물리 메모리를 반환. evict한 개수를 반환 */
+size_t frame_evict_batch(size_t cnt)
+{
+    struct frame_table_entry *victims[FRAME_EVICT_BATCH];
+    size_t evicted, i;
+
+    if (cnt > FRAME_EVICT_BATCH)
+        cnt = FRAME_EVICT_BATCH;
+    evicted = evict_pages(victims, cnt);
+
+    lock_acquire(&frame_lock);
+    for (i = 0; i < evicted; i++)
+        frame_table_remove_entry(victims[i]);
+    lock_release(&frame_lock);
+    return evicted;
 }
 
 /* Static function definition */
-static bool frame_table_add_entry(void *frame, void *upage)
+
+/* 물리 프레임 주소를 Frame Table index로 변환 : O(1) */
+static struct frame_table_entry *frame_table_lookup(void *frame)
+{
+    uint8_t *base = palloc_user_pool_base();
+    size_t idx;
+
+    if (frame == NULL || (uint8_t *)frame < base)
+        return NULL;
+    idx = ((uint8_t *)frame - base) / PGSIZE;
+    return idx < frame_table_size ? &frame_table[idx] : NULL;
+}
+
+static void frame_table_add_entry(void *frame, struct spt_entry *spte)
 {
-    struct frame_table_entry *fte = malloc(sizeof(struct frame_table_entry));
+    struct frame_table_entry *fte = frame_table_lookup(frame);
     
-    if (fte == NULL) 
-        return false;          
+    ASSERT(fte != NULL);
+    ASSERT(fte->frame == NULL);
     
     fte->frame = frame;
-    fte->upage = upage;
+    fte->upage = spte->upage;
+    fte->spte = spte;
     fte->owner = thread_current();
-    fte->pinned = false;  // 기본적으로 핀 False 처리 (교체)
+    fte->pinned = true;   // 로드 및 매핑이 끝날 때까지 교체 방지 (frame_unpin으로 해제)
+    list_init(&fte->sharers);
+    list_push_back(&frame_list, &fte->elem); // clock의 hand 바로 뒤에 추가되는 것과 같음
+    if (replace_policy->on_allocate != NULL)
+        replace_policy->on_allocate(fte);
+}
 
-    
-    list_push_back(&frame_table, &fte->elem);
-    
+static void frame_table_remove_entry(struct frame_table_entry *fte)
+{
+    void *frame = fte->frame;
 
-    return true;
+    ASSERT(list_empty(&fte->sharers));
+    list_remove(&fte->elem);
+    fte->frame = NULL;
+    fte->upage = NULL;
+    fte->spte = NULL;
+    fte->owner = NULL;
+    fte->pinned = false;
+    palloc_free_page(frame); // 물리 메모리 반환
 }
 
-static struct frame_table_entry *frame_table_find_victim(void)
+/* 최대 MAX개의 victim을 골라 evict하고 VICTIMS에 저장, evict한 개수를 반환.
+   victim들은 pinned 상태로 frame_table에 남아 있음.
+   victim 선택과 상태 변경은 frame_lock 안에서, 디스크 I/O는 frame_lock 밖에서 수행.
+   I/O 동안 victim 페이지는 PAGE_EVICTING 상태이며, 이 페이지에 fault가 나면
+   frame_wait_eviction()에서 대기.
+   swap으로 가는 페이지는 먼저 zswap pool에 압축 저장을 시도하고, 나머지는 (owner, upage) 순으로
+   정렬해 연속된 swap slot에 한 번에 기록하므로 이웃한 가상 페이지가 swap disk에서도 이웃하게 됨
+   (swap-in read-ahead 참고). fork로 공유 중인 프레임은 한 번만 기록하고 모든 sharer가 같은 slot을 참조 */
+static size_t evict_pages (struct frame_table_entry *victims[], size_t max)
 {
-    struct frame_table_entry *victim = NULL; // Dirty 페이지 중 임시 후보 저장용
-    struct list_elem *start = hand;          // 순회의 시작점을 저장
-    struct frame_table_entry *current_entry;
-    bool accessed, dirty;
-    
-    do /* 첫 번째 순회 */
-    { 
-        if(hand == NULL)
-        {
-            hand = list_begin(&frame_table);
-        }
-            
-        current_entry = list_entry(hand, struct frame_table_entry, elem);
-        ASSERT(current_entry != NULL);
-        ASSERT(current_entry->owner != NULL);
+    struct frame_table_entry *swap_victims[FRAME_EVICT_BATCH];
+    int status[FRAME_EVICT_BATCH];
+    bool dirty[FRAME_EVICT_BATCH];
+    size_t cnt, swap_cnt = 0, i;
+    struct list_elem *e;
+
+    ASSERT(max <= FRAME_EVICT_BATCH);
+
+    lock_acquire(&frame_lock);
+    for (cnt = 0; cnt < max; cnt++)
+    {
+        /* scan 중 Reference Bit를 지울 때마다 TLB를 flush하지 않고 끝에서 한 번에 처리 */
+        pagedir_tlb_batch_begin();
+        struct frame_table_entry *victim_entry = replace_policy->find_victim();
+        pagedir_tlb_batch_end();
+        if (victim_entry == NULL)
+            break;
 
-        // pinned 여부를 확인하고, pinned된 경우 건너뜀
-        if (current_entry->pinned || current_entry->owner->pagedir == NULL)
+        void *upage = victim_entry->upage; // 사용자 가상 메모리 주소
+        struct spt_entry *spte = victim_entry->spte;
+        struct thread *owner = victim_entry->owner; // 해당 프레임 소유 스레드
+
+        if (victim_entry->frame == NULL || upage == NULL || spte == NULL || owner == NULL)
+            PANIC("Invalid victim frame state!");
+
+        /* 매핑을 먼저 해제하여 write-back 도중 수정되지 않도록 함 (Dirty Bit는 유지됨) */
+        victim_entry->pinned = true;
+        pagedir_clear_page(owner->pagedir, upage);
+        dirty[cnt] = pagedir_is_dirty(owner->pagedir, upage);
+        pagedir_set_dirty(owner->pagedir, upage, false);
+        spte->status = PAGE_EVICTING;
+        victims[cnt] = victim_entry;
+
+        /* copy-on-write로 공유 중인 프레임이면 모든 프로세스의 매핑을 해제 */
+        for (e = list_begin(&victim_entry->sharers); e != list_end(&victim_entry->sharers); e = list_next(e))
         {
-            hand = list_next(hand) == list_end(&frame_table) ? list_begin(&frame_table) : list_next(hand);
-            continue;
+            struct frame_sharer *sharer = list_entry(e, struct frame_sharer, elem);
+
+            pagedir_clear_page(sharer->owner->pagedir, upage);
+            dirty[cnt] |= pagedir_is_dirty(sharer->owner->pagedir, upage);
+            pagedir_set_dirty(sharer->owner->pagedir, upage, false);
+            sharer->spte->status = PAGE_EVICTING;
         }
 
-        // Reference Bit와 Dirty Bit 가져오기
-        // ASSERT(current_entry->owner->pagedir != NULL);
-        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
-        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+        if (spte->is_mmap) // mmap 페이지 : dirty인 경우 file에 write-back, 이후 PAGE_FILE로 복귀
+            status[cnt] = PAGE_FILE;
+        else if (spte->file != NULL && !dirty[cnt]) // 수정되지 않은 실행 파일 페이지 : 버리고 다시 file에서 읽음
+            status[cnt] = PAGE_FILE;
+        else // Anonymous, Stack, 수정된 실행 파일 페이지 : zswap pool 또는 swap disk로 저장
+            status[cnt] = PAGE_SWAP;
+    }
+    evict_cnt += cnt;
+    lock_release(&frame_lock);
 
-        if (!accessed && !dirty) { // Reference Bit = 0, Dirty Bit = 0: 즉시 리턴
-            hand = list_next(hand) == list_end(&frame_table) ? list_begin(&frame_table) : list_next(hand);
-            return current_entry;
-        }
-        else if (!accessed && dirty && victim == NULL) // Reference Bit = 0, Dirty Bit = 1: victim 후보 저장
-            victim = current_entry;
-        
+    if (cnt == 0)
+        return 0;
 
-        // Reference Bit가 1이면 0으로 초기화 후 다음 프레임으로 이동
-        if (accessed)
-            pagedir_set_accessed(current_entry->owner->pagedir, current_entry->upage, false);
+    for (i = 0; i < cnt; i++)
+    {
+        struct spt_entry *spte = victims[i]->spte;
 
-        // hand를 다음 프레임으로 이동 (원형 큐처럼 동작)
-        hand = list_next(hand) == list_end(&frame_table) ? list_begin(&frame_table) : list_next(hand);
-    
-    } while (hand != start); // 한 바퀴 순회 완료
+        if (status[i] == PAGE_SWAP)
+        {
+            /* 먼저 압축하여 zswap pool에 저장. 압축이 잘 되지 않거나 pool이 가득 찬 경우만 swap disk로 */
+            size_t handle = zswap_store(victims[i]->frame);
+
+            if (handle != ZSWAP_ERROR)
+            {
+                spte->swap_index = handle;
+                spte->file = NULL;
+                status[i] = PAGE_ZSWAP;
+            }
+            else
+                swap_victims[swap_cnt++] = victims[i];
+        }
+        else if (spte->is_mmap && dirty[i]) // mmap 페이지 write-back
+        {
+            bool was_holding_lock = lock_held_by_current_thread(&file_lock);
 
-    // 첫 번째 순회 후 Dirty victim 반환
-    if (victim != NULL) {
-        
-        return victim;
+            if (!was_holding_lock)
+                lock_acquire(&file_lock);
+            file_write_at(spte->file, victims[i]->frame, spte->page_read_bytes, spte->ofs);
+            if (!was_holding_lock)
+                lock_release(&file_lock);
+        }
     }
-    
-    start = hand;
-    do /* 두 번째 순회 */
+
+    /* Clustered swap-out : 정렬 후 연속된 slot에 순서대로 기록 */
+    if (swap_cnt > 0)
     {
-        current_entry = list_entry(hand, struct frame_table_entry, elem);
+        size_t slot;
 
-        // pinned 여부를 확인하고, pinned된 경우 건너뜀
-        if (current_entry->pinned || current_entry->owner->pagedir == NULL)
+        sort_victims(swap_victims, swap_cnt);
+        slot = swap_alloc_slots(swap_cnt);
+        for (i = 0; i < swap_cnt; i++)
         {
-            hand = list_next(hand) == list_end(&frame_table) ? list_begin(&frame_table) : list_next(hand);
-            continue;
+            struct spt_entry *spte = swap_victims[i]->spte;
+
+            if (slot != BITMAP_ERROR) // 연속 slot 할당 성공
+            {
+                spte->swap_index = slot + i;
+                swap_write_slot(spte->swap_index, swap_victims[i]->frame);
+            }
+            else
+                spte->swap_index = swap_out(swap_victims[i]->frame);
+            spte->file = NULL; // 이후로는 file과 내용이 다르므로 anonymous로 취급
         }
+    }
 
-        // Reference Bit와 Dirty Bit 가져오기
-        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
-        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+    lock_acquire(&frame_lock);
+    for (i = 0; i < cnt; i++)
+    {
+        struct spt_entry *spte = victims[i]->spte;
 
-        if (!accessed && !dirty) {
-            // Reference Bit = 0, Dirty Bit = 0: 즉시 리턴
-            hand = start;
-            return current_entry;
-        }
-        else if (!accessed && dirty && victim == NULL) // Reference Bit = 0, Dirty Bit = 1: victim 후보 저장
-            victim = current_entry;
-        
+        spte->status = status[i];
 
-        // hand를 다음 프레임으로 이동 (원형 큐처럼 동작)
-        hand = list_next(hand) == list_end(&frame_table) ? list_begin(&frame_table) : list_next(hand);
+        /* 공유하던 프로세스들은 같은 swap slot(zswap handle)을 참조 */
+        while (!list_empty(&victims[i]->sharers))
+        {
+            struct frame_sharer *sharer = list_entry(list_pop_front(&victims[i]->sharers), struct frame_sharer, elem);
 
-    } while (hand != start); // 두 바퀴 순회 완료
-    
-    hand = start;    
-    
-    return victim;
-    
-    /* Not Reached : 두 바퀴 순회에도 적절한 프레임을 찾지 못한 경우는 발생하지 않음 */
+            sharer->spte->status = status[i];
+            if (status[i] == PAGE_SWAP || status[i] == PAGE_ZSWAP)
+            {
+                sharer->spte->swap_index = spte->swap_index;
+                sharer->spte->file = NULL;
+                if (status[i] == PAGE_SWAP)
+                    swap_dup_slot(spte->swap_index);
+                else
+                    zswap_dup(spte->swap_index);
+            }
+            kmem_cache_free(sharer_cache, sharer);
+        }
+        victims[i]->spte = NULL;
+    }
+    cond_broadcast(&evict_done, &frame_lock); // 이 페이지들을 기다리는 fault handler 깨우기
+    lock_release(&frame_lock);
+    return cnt;
 }
 
-static bool swap_out_evicted_page (struct frame_table_entry *victim_entry)
+/* VICTIMS를 (owner, upage) 순으로 정렬 (삽입 정렬, CNT <= FRAME_EVICT_BATCH) */
+static void sort_victims (struct frame_table_entry *victims[], size_t cnt)
 {
-    ASSERT(victim_entry != NULL)
-    void *frame = victim_entry->frame; // 물리 메모리 프레임 주소
-    void *upage = victim_entry->upage; // 사용자 가상 메모리 주소
-    struct thread *owner = victim_entry->owner; // 해당 프레임 소유 스레드
-
-    if (frame == NULL || upage == NULL || owner == NULL)
-        PANIC("Invalid victim frame state!");
-
-    size_t swap_index = swap_out(frame);
-    struct spt_entry *spte = spt_find_page(&owner->spt, upage);
-    if (spte == NULL)
-        PANIC("SPT entry not found for evicted page!");
-
-    spte->status = PAGE_SWAP;      // 페이지 상태를 PAGE_SWAP으로 변경
-    spte->swap_index = swap_index; // 스왑 인덱스 저장
+    size_t i, j;
 
-    pagedir_clear_page(owner->pagedir, upage);
-    struct frame_table_entry *fte;
-    struct list_elem *e;
-    for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+    for (i = 1; i < cnt; i++)
     {
-        fte = list_entry(e, struct frame_table_entry, elem);
-        if (fte->frame == frame)
+        struct frame_table_entry *key = victims[i];
+
+        for (j = i; j > 0; j--)
         {
-            if (e == hand)
-                hand = list_remove(e); // Frame Table에서 제거
-            else
-                list_remove(e);
-            palloc_free_page(frame); // 물리 메모리 반환
-            free(fte);               // Frame Table Entry 해제
-            break;
+            struct frame_table_entry *prev = victims[j - 1];
+
+            if (prev->owner->tid < key->owner->tid
+                || (prev->owner == key->owner && prev->upage < key->upage))
+                break;
+            victims[j] = prev;
         }
+        victims[j] = key;
     }
-    return true;
 }
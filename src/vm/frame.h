@@ -1,27 +1,61 @@
 #ifndef FRAME_H
 #define FRAME_H
 
+#include <list.h>
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "vm/page.h"
 
-struct list frame_table;
-struct lock frame_lock;
-struct list_elem *hand; // frame_table 순회를 위한 커서
 struct frame_table_entry
 {
-    void *frame;            // 물리 프레임 주소
+    void *frame;            // 물리 프레임 주소 (NULL이면 빈 슬롯)
     void *upage;            // 가상 메모리 주소 (User Page)
+    struct spt_entry *spte; // 이 프레임에 적재된 페이지의 SPT entry
     struct thread *owner;   // 이 프레임을 소유한 스레드
-    bool pinned;            // 핀 여부 (페이지 교체 방지)
-    
-    struct list_elem elem;  // Frame Table 리스트 요소
+    bool pinned;            // 핀 여부 (로드/evict I/O 중인 프레임의 교체 방지)
+    struct list_elem elem;  // frame_list의 원소
+    struct list sharers;    // fork 후 이 프레임을 copy-on-write로 함께 매핑한 다른 프로세스
+                            // (struct frame_sharer, 같은 upage. owner/spte가 비면 첫 sharer가 승계)
+
+    /* 교체 정책에서 사용 (vm/policy.c) */
+    int64_t last_used;      // WSClock : 마지막 참조 시각 (ticks)
+    uint8_t age;            // Aging : LRU 근사 카운터
 };
 
+/* 한 번의 eviction pass에서 evict할 수 있는 최대 페이지 수 */
+#define FRAME_EVICT_BATCH 8
+
+/* Large page(4MB) 하나를 이루는 프레임 수 */
+#define FRAME_LARGE_PAGES (PTSPAN / PGSIZE)
+
+/* user pool과 1:1 대응하는 Frame Table
+   index = (kpage - palloc_user_pool_base()) / PGSIZE */
+extern struct frame_table_entry *frame_table;
+extern size_t frame_table_size;
+
+/* 사용 중인 entry(frame != NULL)만 모은 리스트. frame_table은 kernel 페이지까지 포함한
+   pool 전체에 대응하므로, 교체 정책은 frame_table 대신 이 리스트를 순회 */
+extern struct list frame_list;
+extern struct lock frame_lock;
+
+/* 모든 프로세스가 공유하는 읽기 전용 zero frame (kernel pool, frame_table에 속하지 않음).
+   PAGE_ZERO 페이지의 읽기 fault에 매핑되며 첫 write fault에서 private frame으로 교체됨 */
+extern void *zero_frame;
 
 void frame_table_init(void);
-void *frame_allocate(enum palloc_flags flags, void *upage);
+void *frame_allocate(enum palloc_flags flags, struct spt_entry *spte);
+void *frame_try_allocate(enum palloc_flags flags, struct spt_entry *spte);
+void *frame_try_allocate_large(void);
+void frame_register_large(void *kpage, void *upage);
 void frame_deallocate(void *frame);
-bool frame_evict(void);
+void *frame_pin_page(struct spt_entry *spte);
+void frame_unpin(void *frame);
+bool frame_share(void *frame, struct thread *owner, struct spt_entry *spte);
+bool frame_is_shared(void *frame);
+void frame_release(void *frame, struct spt_entry *spte);
+void frame_wait_eviction(struct spt_entry *spte);
+size_t frame_evict_batch(size_t cnt);
+void frame_print_stats(void);
 
 #endif /* FRAME_H */
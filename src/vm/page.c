@@ -1,95 +1,223 @@
 #include "vm/page.h"
 #include "lib/kernel/hash.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "filesys/file.h"
 #include "lib/user/syscall.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
+
+static struct kmem_cache *spt_cache;   // struct spt_entry
+static struct kmem_cache *mmt_cache;   // struct mmt_entry
+
+static struct spt_entry *spt_insert_entry(struct spt *spt, void *upage, struct file *file,
+                  off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, int status);
+
+/* SPT, MMT entry cache 생성 (부팅 시 한 번) */
+void page_init(void)
+{
+    spt_cache = kmem_cache_create("spt_entry", sizeof (struct spt_entry), NULL);
+    mmt_cache = kmem_cache_create("mmt_entry", sizeof (struct mmt_entry), NULL);
+}
 
 /* SPT function Definition*/
-void spt_init(struct hash *spt)
+void spt_init(struct spt *spt)
 {
-    hash_init(spt, spt_hash_func, spt_less_func, NULL);
+    list_init(&spt->areas);
+    spt->cache = NULL;
+    hash_init(&spt->pages, spt_hash_func, spt_less_func, NULL);
 }
 
-void spt_destroy(struct hash *spt)
+/* evict 중인 페이지와의 경쟁을 막기 위해 frame_lock을 잡고 제거 */
+void spt_destroy(struct spt *spt)
 {
-    hash_destroy(spt, spt_destructor);
+    lock_acquire(&frame_lock);
+    hash_destroy(&spt->pages, spt_destructor);
+    lock_release(&frame_lock);
+    vma_destroy(spt);
 }
 
+/* frame_lock을 잡은 상태에서 호출 (spt_destroy 참고) */
 void spt_destructor(struct hash_elem *e, void *aux UNUSED)
 {
     struct spt_entry *entry = hash_entry(e, struct spt_entry, hash_elem);
     uint32_t *pagedir = thread_current()->pagedir;
     if(entry) {
+        frame_wait_eviction(entry); // evict I/O 중이면 완료(PAGE_SWAP, PAGE_FILE)까지 대기
+
         if(entry->status == PAGE_PRESENT) {
             ASSERT(pagedir != NULL);
             void *frame = pagedir_get_page(pagedir, entry->upage);
-            frame_deallocate(frame);
-            pagedir_clear_page(pagedir, entry->upage);
+            frame_release(frame, entry); // fork로 공유 중이면 다른 프로세스를 위해 프레임 유지
+            // 4MB 페이지는 분할하지 않고 pagedir_destroy()에서 PDE 하나로 해제
+            if (!pagedir_is_large(pagedir, entry->upage))
+                pagedir_clear_page(pagedir, entry->upage);
         }
         else if(entry->status == PAGE_SWAP) {
             ASSERT(entry->swap_index != -1);
             swap_free_slot(entry->swap_index);
             entry->swap_index = -1;
         }
+        else if(entry->status == PAGE_ZERO) {
+            // 공유 zero frame 매핑은 pagedir_destroy()에서 해제되지 않도록 제거
+            if (pagedir != NULL && pagedir_get_page(pagedir, entry->upage) == zero_frame)
+                pagedir_clear_page(pagedir, entry->upage);
+        }
+        else if(entry->status == PAGE_ZSWAP) {
+            zswap_free(entry->swap_index);
+            entry->swap_index = -1;
+        }
     }
-    free(entry);
+    kmem_cache_free(spt_cache, entry);
 }
 
-struct spt_entry *spt_find_page(struct hash *spt, void *upage)
+/* fork : PARENT의 SPT를 현재 스레드(자식)의 SPT로 복제. mmap 영역은 mmt 복제 시 추가되므로 제외.
+   실행 파일 영역은 그대로 복제하고, spt_entry가 있는 페이지만 다음과 같이 복제.
+   메모리에 있는 페이지는 프레임을 공유하며 쓰기 가능한 페이지는 부모, 자식 모두 읽기 전용으로
+   매핑 (copy-on-write, cow_page_write() 참고). swap된 페이지는 swap slot(zswap handle)을 공유.
+   실행 파일 페이지는 자식의 실행 파일 FILE을 참조. 부모는 fork가 끝날 때까지 대기 중이어야 함 */
+bool spt_fork(struct thread *parent, struct file *file)
+{
+    struct thread *cur = thread_current();
+    struct hash_iterator i;
+    struct list_elem *e;
+    bool success = true;
+
+    for (e = list_begin(&parent->spt.areas); e != list_end(&parent->spt.areas); e = list_next(e))
+    {
+        struct vm_area *vma = list_entry(e, struct vm_area, elem);
+
+        if (vma->kind == VMA_EXEC
+            && !vma_add(&cur->spt, vma->start, vma->end - vma->start, file, vma->ofs,
+                        vma->read_bytes, vma->writable, VMA_EXEC))
+            return false;
+    }
+
+    lock_acquire(&frame_lock);
+    hash_first(&i, &parent->spt.pages);
+    while (success && hash_next(&i))
+    {
+        struct spt_entry *pe = hash_entry(hash_cur(&i), struct spt_entry, hash_elem);
+        struct spt_entry *ce;
+
+        if (pe->is_mmap)
+            continue;
+        frame_wait_eviction(pe); // evict I/O 중이면 완료 후의 상태를 복제
+
+        ce = spt_insert_entry(&cur->spt, pe->upage, pe->file != NULL ? file : NULL, pe->ofs,
+                              pe->page_read_bytes, pe->page_zero_bytes, pe->writable, pe->status);
+        if (ce == NULL)
+        {
+            success = false;
+            break;
+        }
+
+        switch (pe->status)
+        {
+        case PAGE_PRESENT:
+        {
+            void *kpage = pagedir_get_page(parent->pagedir, pe->upage);
+
+            if (!pagedir_set_page(cur->pagedir, pe->upage, kpage, false) || !frame_share(kpage, cur, ce))
+            {
+                pagedir_clear_page(cur->pagedir, pe->upage);
+                hash_delete(&cur->spt.pages, &ce->hash_elem);
+                kmem_cache_free(spt_cache, ce);
+                success = false;
+                break;
+            }
+            if (pe->writable)
+                pagedir_set_writable(parent->pagedir, pe->upage, false);
+            // 실행 파일 페이지가 file과 달라졌는지 eviction 때 알 수 있도록 Dirty Bit 복제
+            pagedir_set_dirty(cur->pagedir, pe->upage, pagedir_is_dirty(parent->pagedir, pe->upage));
+            break;
+        }
+        case PAGE_SWAP:
+            swap_dup_slot(pe->swap_index);
+            ce->swap_index = pe->swap_index;
+            break;
+        case PAGE_ZSWAP:
+            zswap_dup(pe->swap_index);
+            ce->swap_index = pe->swap_index;
+            break;
+        default: // PAGE_FILE, PAGE_ZERO : 자식도 처음 접근할 때 로드
+            break;
+        }
+    }
+    lock_release(&frame_lock);
+    return success;
+}
+
+/* UPAGE의 spt_entry를 반환. 아직 entry가 없는 페이지면 UPAGE를 포함하는 영역에서 만들어 반환.
+   어떤 영역에도 속하지 않으면 NULL 반환 */
+struct spt_entry *spt_find_page(struct spt *spt, void *upage)
+{
+    struct spt_entry *entry;
+    struct vm_area *vma;
+    size_t page_ofs;
+
+    upage = pg_round_down(upage);
+    entry = spt_lookup_page(spt, upage);
+    if (entry != NULL)
+        return entry;
+
+    vma = vma_find(spt, upage);
+    if (vma == NULL)
+        return NULL;
+
+    page_ofs = (uint8_t *)upage - vma->start;
+    if (page_ofs < vma->read_bytes)
+    {
+        size_t page_read_bytes = vma->read_bytes - page_ofs < PGSIZE ? vma->read_bytes - page_ofs : PGSIZE;
+        entry = spt_insert_entry(spt, upage, vma->file, vma->ofs + page_ofs,
+                                 page_read_bytes, PGSIZE - page_read_bytes, vma->writable, PAGE_FILE);
+    }
+    else // 파일에서 읽을 내용이 없는 페이지(BSS)는 공유 zero frame 사용
+        entry = spt_insert_entry(spt, upage, NULL, 0, 0, PGSIZE, vma->writable, PAGE_ZERO);
+
+    if (entry != NULL)
+        entry->is_mmap = vma->kind == VMA_MMAP; // eviction 시 swap 대신 file로 write-back
+    return entry;
+}
+
+/* 이미 spt_entry가 있는 페이지만 찾음 (영역에서 새로 만들지 않음) */
+struct spt_entry *spt_lookup_page(struct spt *spt, void *upage)
 {
     struct spt_entry entry;
     struct hash_elem *e;
 
     entry.upage = pg_round_down(upage);
-    e = hash_find(spt, &entry.hash_elem);
+    e = hash_find(&spt->pages, &entry.hash_elem);
 
     return e != NULL ? hash_entry(e, struct spt_entry, hash_elem) : NULL;
 }
 
-void spt_remove_page(struct hash *spt, void *upage)
+void spt_remove_page(struct spt *spt, void *upage)
 {
     struct spt_entry entry;
     struct hash_elem *e;
 
     entry.upage = upage;
-    e = hash_delete(spt, &entry.hash_elem);
+    e = hash_delete(&spt->pages, &entry.hash_elem);
     
 
     if (e != NULL) {
         struct spt_entry *entry = hash_entry(e, struct spt_entry, hash_elem);
-        free(entry);
+        kmem_cache_free(spt_cache, entry);
     }
          
 }
 
-void spt_cleanup_partial(struct hash *spt, void *upage_start) 
-{
-    struct hash_iterator it;
-    struct spt_entry *entry;
-    hash_first(&it, spt);
-
-    while (hash_next(&it)) {
-        entry = hash_entry(hash_cur(&it), struct spt_entry, hash_elem);
-
-        // 현재 페이지가 upage_start 이후의 주소인지 확인
-        if (entry->upage >= upage_start) {
-            hash_delete(spt, &entry->hash_elem);
-            free(entry); 
-        }
-    }
-}
-
-bool spt_add_page(struct hash *spt, void *upage, struct file *file,
+/* SPT entry 할당 및 삽입 : 실패 시 NULL 반환 */
+static struct spt_entry *spt_insert_entry(struct spt *spt, void *upage, struct file *file,
                   off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, int status)
 {
-    struct spt_entry *entry = malloc(sizeof(struct spt_entry));
+    struct spt_entry *entry = kmem_cache_alloc(spt_cache);
     
     if (entry == NULL)
-        return false;
+        return NULL;
 
     entry->upage = upage;
     entry->file = file;
@@ -98,10 +226,20 @@ bool spt_add_page(struct hash *spt, void *upage, struct file *file,
     entry->page_zero_bytes = page_zero_bytes;
     entry->status = status;
     entry->writable = writable;
+    entry->is_mmap = false;
     entry->swap_index = 0;
 
-    struct hash_elem *result = hash_insert(spt, &entry->hash_elem);
-    return result == NULL; // NULL 반환 시 성공적으로 삽입된 것
+    if (hash_insert(&spt->pages, &entry->hash_elem) != NULL) {
+        kmem_cache_free(spt_cache, entry);
+        return NULL;
+    }
+    return entry;
+}
+
+bool spt_add_page(struct spt *spt, void *upage, struct file *file,
+                  off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, int status)
+{
+    return spt_insert_entry(spt, upage, file, ofs, page_read_bytes, page_zero_bytes, writable, status) != NULL;
 }
 
 unsigned spt_hash_func(const struct hash_elem *e, void *aux)
@@ -146,7 +284,7 @@ void mmt_destructor(struct hash_elem *e, void *aux UNUSED)
             entry->swap_index = -1;
         }
     }
-    free(entry);
+    kmem_cache_free(mmt_cache, entry);
 }
 
 struct mmt_entry *mmt_find_entry(struct hash *mmt, mapid_t *mmap_id)
@@ -159,30 +297,39 @@ struct mmt_entry *mmt_find_entry(struct hash *mmt, mapid_t *mmap_id)
     return e != NULL ? hash_entry(e, struct mmt_entry, hash_elem) : NULL;
 }
 
+/* munmap : ENTRY를 MMT에서 제거하고 해제 */
+void mmt_remove_entry(struct hash *mmt, struct mmt_entry *entry)
+{
+    hash_delete(mmt, &entry->hash_elem);
+    kmem_cache_free(mmt_cache, entry);
+}
+
+/* mmap : [UPAGE, UPAGE + file 길이)를 FILE의 VMA_MMAP 영역으로 추가.
+   페이지별 spt_entry는 처음 접근할 때 만들어짐 (spt_find_page 참고) */
 bool mmt_add_page(struct hash* mmt, mapid_t id, struct file *file, void *upage)
 {
-    struct mmt_entry *entry = malloc(sizeof (struct mmt_entry));
-    entry->mmap_id = id;
-    entry->file = file;
-    entry->upage = upage;
+    struct spt *spt = &thread_current()->spt;
+    off_t size = file_length(file);
     off_t ofs;
-    struct hash *spt = &thread_current()->spt;
-    int size = file_length(file);
 
+    /* 다른 영역이나 스택 페이지와 겹치면 실패 */
+    if (vma_overlaps(spt, upage, size))
+        return false;
     for (ofs = 0; ofs < size; ofs += PGSIZE)
-    {
-        if(spt_find_page(spt, upage)){
+        if (spt_lookup_page(spt, (uint8_t *)upage + ofs) != NULL)
             return false;
-        }
-    }
-    size_t page_read_bytes, page_zero_bytes;
 
-    for (ofs = 0; ofs < size; ofs += PGSIZE)
+    struct mmt_entry *entry = kmem_cache_alloc(mmt_cache);
+    if (entry == NULL)
+        return false;
+    entry->mmap_id = id;
+    entry->file = file;
+    entry->upage = upage;
+
+    if (size > 0 && !vma_add(spt, upage, size, file, 0, size, true, VMA_MMAP))
     {
-        page_read_bytes = ofs + PGSIZE < size ? PGSIZE : size - ofs;
-        page_zero_bytes = PGSIZE - page_read_bytes;
-        spt_add_page(spt, upage, file, ofs, page_read_bytes, page_zero_bytes, true, PAGE_FILE);
-        upage += PGSIZE;
+        kmem_cache_free(mmt_cache, entry);
+        return false;
     }
     struct hash_elem *result = hash_insert(mmt, &entry->hash_elem);
     return result == NULL; // NULL 반환 시 성공적으로 삽입된 것
@@ -2,6 +2,7 @@
 #define PAGE_H
 
 #include "threads/thread.h"
+#include "vm/vma.h"
 #include "filesys/file.h" // `off_t`와 파일 관련 정의 포함
 #include "lib/user/syscall.h"
 
@@ -10,6 +11,8 @@
 #define PAGE_PRESENT 2 // 현재 메모리에 있는 페이지
 #define PAGE_SWAP 3    // 스왑 디스크에 저장된 페이지
 #define PAGE_ZERO 4    // 0으로 초기화된 페이지
+#define PAGE_EVICTING 5 // evict I/O(swap out, write-back) 진행 중인 페이지
+#define PAGE_ZSWAP 6   // 압축되어 메모리(zswap pool)에 있는 페이지
 
 struct spt_entry{
     int status;                 
@@ -21,23 +24,26 @@ struct spt_entry{
     off_t ofs;                  // File offset
     size_t page_read_bytes;     // 파일에서 읽어야 할 바이트 수
     size_t page_zero_bytes;     // 0으로 초기화할 바이트 수
+    bool is_mmap;               // mmap 페이지 여부 (dirty 시 file에 write-back)
     
-    /* for PAGE_SWAP */
-    size_t swap_index;          
+    /* for PAGE_SWAP, PAGE_ZSWAP */
+    size_t swap_index;          // swap slot index 또는 zswap handle
 
     struct hash_elem hash_elem;
 };
 
 /* init & management func */
-void spt_init(struct hash *spt);
-void spt_destroy(struct hash *spt);
+void page_init(void);
+void spt_init(struct spt *spt);
+void spt_destroy(struct spt *spt);
 void spt_destructor(struct hash_elem *e, void *aux UNUSED);
 
 /* func of manage SPT entry */
-struct spt_entry *spt_find_page(struct hash *spt, void *upage);
-void spt_remove_page(struct hash *spt, void *upage);
-void spt_cleanup_partial(struct hash *spt, void *upage_start) ;
-bool spt_add_page(struct hash *spt, void *upage, struct file *file,
+struct spt_entry *spt_find_page(struct spt *spt, void *upage);
+struct spt_entry *spt_lookup_page(struct spt *spt, void *upage);
+void spt_remove_page(struct spt *spt, void *upage);
+bool spt_fork(struct thread *parent, struct file *file);
+bool spt_add_page(struct spt *spt, void *upage, struct file *file,
                   off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, int status);
 
 /* SPT entry hash func */
@@ -62,6 +68,7 @@ void mmt_destructor(struct hash_elem *e, void *aux UNUSED);
 /* func of manage MMT entry */
 struct mmt_entry *mmt_find_entry(struct hash *mmt, mapid_t *mmap_id);
 bool mmt_add_page(struct hash *mmt, mapid_t id, struct file *file, void *upage);
+void mmt_remove_entry(struct hash *mmt, struct mmt_entry *entry);
 
 /* File MMT entry hash func */
 unsigned mmt_hash_func(const struct hash_elem *e, void *aux);
@@ -0,0 +1,122 @@
+#include "vm/pageout.h"
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+
+/* 한 번에 evict하는 최대 페이지 수 (batch 사이에 CPU를 양보) */
+#define PAGEOUT_BATCH FRAME_EVICT_BATCH
+
+static size_t low_wmark, high_wmark;    // 여유 프레임 watermark (pages)
+static bool wmark_set;                  // -pageout 옵션으로 지정되었는지 여부
+static bool running;                    // daemon 스레드 생성 여부
+static bool pending;                    // daemon에 이미 깨우기 요청을 보냈는지 여부 (frame_lock으로 보호)
+static struct semaphore pageout_sema;
+
+/* 통계 */
+static unsigned long long wakeup_cnt, batch_cnt, evict_cnt;
+
+static void pageout_daemon(void *aux UNUSED);
+
+/* SPEC("LOW,HIGH")으로 watermark 설정. LOW가 0이면 daemon을 사용하지 않음 */
+bool pageout_set_watermarks(const char *spec)
+{
+    const char *comma;
+    int low, high;
+
+    if (spec == NULL || (comma = strchr(spec, ',')) == NULL)
+        return false;
+    low = atoi(spec);
+    high = atoi(comma + 1);
+    if (low < 0 || high < low)
+        return false;
+
+    low_wmark = low;
+    high_wmark = high;
+    wmark_set = true;
+    return true;
+}
+
+void pageout_init(void)
+{
+    size_t frames = palloc_user_pool_size();
+
+    /* 기본값 : user pool의 1/32 (최소 4 pages) ~ 그 2배 */
+    if (!wmark_set)
+    {
+        low_wmark = frames / 32 < 4 ? 4 : frames / 32;
+        high_wmark = low_wmark * 2;
+    }
+    if (high_wmark > frames)
+        high_wmark = frames;
+    if (low_wmark > high_wmark)
+        low_wmark = high_wmark;
+
+    sema_init(&pageout_sema, 0);
+    if (low_wmark == 0)
+        return;
+    running = thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL) != TID_ERROR;
+}
+
+/* 여유 프레임이 low watermark 아래면 daemon을 깨움. frame_lock을 잡은 상태에서 호출 */
+void pageout_check(void)
+{
+    ASSERT(lock_held_by_current_thread(&frame_lock));
+
+    if (running && !pending && palloc_user_free_cnt() < low_wmark)
+    {
+        pending = true;
+        sema_up(&pageout_sema);
+    }
+}
+
+/* 여유 user 프레임이 low watermark 미만이면 true */
+bool pageout_low(void)
+{
+    return palloc_user_free_cnt() < low_wmark;
+}
+
+/* Prints page-out daemon statistics. */
+void pageout_print_stats(void)
+{
+    printf("Pageout: %llu wakeups, %llu batches, %llu pages evicted (watermarks %zu/%zu)\n",
+           wakeup_cnt, batch_cnt, evict_cnt, low_wmark, high_wmark);
+}
+
+static void pageout_daemon(void *aux UNUSED)
+{
+    for (;;)
+    {
+        bool done = false;
+
+        sema_down(&pageout_sema);
+        wakeup_cnt++;
+
+        /* high watermark에 도달하거나 더 이상 evict할 프레임이 없을 때까지 batch 단위로 evict.
+           한 batch의 swap-out은 연속된 slot에 한 번에 기록됨.
+           frame_evict_batch()는 I/O 동안 frame_lock을 잡지 않으므로 page fault와 동시에 진행됨 */
+        while (!done)
+        {
+            size_t free_cnt = palloc_user_free_cnt();
+            size_t want = high_wmark - free_cnt;
+            size_t evicted;
+
+            if (free_cnt >= high_wmark)
+                break;
+            evicted = frame_evict_batch(want < PAGEOUT_BATCH ? want : PAGEOUT_BATCH);
+            if (evicted == 0)
+                done = true;
+            evict_cnt += evicted;
+            batch_cnt++;
+            thread_yield(); // batch 사이에 다른 스레드에게 CPU 양보
+        }
+
+        lock_acquire(&frame_lock);
+        pending = false;
+        lock_release(&frame_lock);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef PAGEOUT_H
+#define PAGEOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Page-out Daemon : 여유 user 프레임 수가 low watermark 아래로 떨어지면 깨어나
+   high watermark에 도달할 때까지 백그라운드에서 페이지를 evict */
+bool pageout_set_watermarks(const char *spec);  /* "-pageout=LOW,HIGH" 옵션 처리 */
+void pageout_init(void);                        /* daemon 스레드 생성 (swap 초기화 이후) */
+void pageout_check(void);                       /* frame 할당 후 watermark 검사 */
+bool pageout_low(void);                         /* 여유 프레임이 low watermark 미만인지 */
+void pageout_print_stats(void);
+
+#endif /* PAGEOUT_H */
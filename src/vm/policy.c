@@ -0,0 +1,259 @@
+#include "vm/policy.h"
+#include "vm/frame.h"
+#include "userprog/pagedir.h"
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include <debug.h>
+#include <string.h>
+
+/* WSClock : 이 시간(ticks)동안 참조되지 않은 페이지는 working set 밖으로 간주 */
+#define WSCLOCK_TAU (TIMER_FREQ / 4)
+
+/* LRU 근사(Aging) : 카운터 갱신 주기(ticks)와 새 프레임의 초기 카운터 값 */
+#define AGING_PERIOD (TIMER_FREQ / 10)
+#define AGE_INIT 0x80
+
+
+static struct frame_table_entry *clock_find_victim(void);
+static void wsclock_on_allocate(struct frame_table_entry *fte);
+static struct frame_table_entry *wsclock_find_victim(void);
+static void aging_on_allocate(struct frame_table_entry *fte);
+static struct frame_table_entry *aging_find_victim(void);
+static void aging_age(void);
+static thread_func aging_thread NO_RETURN;
+
+static const struct replace_policy clock_policy = {"clock", NULL, clock_find_victim, NULL};
+static const struct replace_policy wsclock_policy = {"wsclock", wsclock_on_allocate, wsclock_find_victim, NULL};
+static const struct replace_policy aging_policy = {"lru", aging_on_allocate, aging_find_victim, aging_age};
+
+static const struct replace_policy *const policies[] = {&clock_policy, &wsclock_policy, &aging_policy, NULL};
+
+const struct replace_policy *replace_policy = &clock_policy;
+
+/* NAME에 해당하는 교체 정책을 선택. 없는 이름이면 false 반환 */
+bool replace_policy_select(const char *name)
+{
+    const struct replace_policy *const *p;
+
+    for (p = policies; *p != NULL; p++)
+        if (!strcmp((*p)->name, name))
+        {
+            replace_policy = *p;
+            return true;
+        }
+    return false;
+}
+
+/* 선택된 정책에 age()가 있으면 AGING_PERIOD마다 이를 호출하는 "aging" 스레드를 생성 */
+void replace_policy_init(void)
+{
+    if (replace_policy->age == NULL)
+        return;
+    if (thread_create("aging", PRI_DEFAULT, aging_thread, NULL) == TID_ERROR)
+        PANIC("Failed to create aging thread!");
+}
+
+static void aging_thread(void *aux UNUSED)
+{
+    for (;;)
+    {
+        timer_sleep(AGING_PERIOD);
+
+        lock_acquire(&frame_lock);
+        replace_policy->age();
+        lock_release(&frame_lock);
+    }
+}
+
+/* victim 후보가 될 수 있는 프레임인지 확인 : pinned, 종료 중인 프로세스 제외 */
+static bool frame_is_evictable(const struct frame_table_entry *fte)
+{
+    return !fte->pinned && fte->owner->pagedir != NULL;
+}
+
+/* clock, wsclock : frame_list의 맨 앞이 hand가 가리키는 프레임.
+   hand를 다음 프레임으로 이동 (맨 앞 프레임을 맨 뒤로 옮겨 원형 큐처럼 동작)하고 지나온 프레임을 반환.
+   별도의 커서를 두지 않으므로 프레임이 반환되어도 hand를 고칠 필요가 없음 */
+static struct frame_table_entry *advance_hand(void)
+{
+    struct list_elem *e = list_pop_front(&frame_list);
+
+    list_push_back(&frame_list, e);
+    return list_entry(e, struct frame_table_entry, elem);
+}
+
+/* Enhanced Clock : (Reference Bit, Dirty Bit) 기준 2회 순회 */
+static struct frame_table_entry *clock_find_victim(void)
+{
+    struct frame_table_entry *victim = NULL; // Dirty 페이지 중 임시 후보 저장용
+    struct list_elem *start;                 // 순회의 시작점을 저장
+    struct frame_table_entry *current_entry;
+    bool accessed, dirty;
+
+    if (list_empty(&frame_list))
+        return NULL;
+
+    start = list_front(&frame_list);
+    do /* 첫 번째 순회 */
+    {
+        current_entry = advance_hand();
+
+        // pinned된 경우 건너뜀
+        if (!frame_is_evictable(current_entry))
+            continue;
+
+        // Reference Bit와 Dirty Bit 가져오기
+        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
+        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+
+        if (!accessed && !dirty) // Reference Bit = 0, Dirty Bit = 0: 즉시 리턴
+            return current_entry;
+        else if (!accessed && dirty && victim == NULL) // Reference Bit = 0, Dirty Bit = 1: victim 후보 저장
+            victim = current_entry;
+
+        // Reference Bit가 1이면 0으로 초기화 후 다음 프레임으로 이동
+        if (accessed)
+            pagedir_set_accessed(current_entry->owner->pagedir, current_entry->upage, false);
+
+    } while (list_front(&frame_list) != start); // 한 바퀴 순회 완료
+
+    // 첫 번째 순회 후 Dirty victim 반환
+    if (victim != NULL) {
+
+        return victim;
+    }
+
+    do /* 두 번째 순회 */
+    {
+        current_entry = advance_hand();
+
+        // pinned된 경우 건너뜀
+        if (!frame_is_evictable(current_entry))
+            continue;
+
+        // Reference Bit와 Dirty Bit 가져오기
+        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
+        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+
+        if (!accessed && !dirty) // Reference Bit = 0, Dirty Bit = 0: 즉시 리턴
+            return current_entry;
+        else if (!accessed && dirty && victim == NULL) // Reference Bit = 0, Dirty Bit = 1: victim 후보 저장
+            victim = current_entry;
+
+    } while (list_front(&frame_list) != start); // 두 바퀴 순회 완료
+
+    return victim;
+
+    /* Not Reached : 두 바퀴 순회에도 적절한 프레임을 찾지 못한 경우는 발생하지 않음 */
+}
+
+/* WSClock : 마지막 참조 시각을 기록 */
+static void wsclock_on_allocate(struct frame_table_entry *fte)
+{
+    fte->last_used = timer_ticks();
+}
+
+/* WSClock : 한 바퀴 순회하며 working set(최근 WSCLOCK_TAU ticks) 밖의 페이지를 선택
+     1. Reference Bit = 1 : 0으로 초기화, 참조 시각 갱신
+     2. working set 밖 && clean : 즉시 리턴
+     3. working set 밖 && dirty : 후보로 저장 (clean 페이지가 없을 때 선택)
+   working set 밖의 페이지가 없으면 가장 오래전에 참조된 페이지를 선택 (clean 우선) */
+static struct frame_table_entry *wsclock_find_victim(void)
+{
+    struct frame_table_entry *dirty_victim = NULL, *oldest = NULL;
+    bool oldest_dirty = false;
+    int64_t now = timer_ticks();
+    struct list_elem *start;
+    struct frame_table_entry *current_entry;
+    bool accessed, dirty;
+
+    if (list_empty(&frame_list))
+        return NULL;
+
+    start = list_front(&frame_list);
+    do
+    {
+        current_entry = advance_hand();
+        if (!frame_is_evictable(current_entry))
+            continue;
+
+        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
+        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+
+        if (accessed)
+        {
+            pagedir_set_accessed(current_entry->owner->pagedir, current_entry->upage, false);
+            current_entry->last_used = now;
+        }
+        else if (now - current_entry->last_used > WSCLOCK_TAU)
+        {
+            if (!dirty)
+                return current_entry;
+            if (dirty_victim == NULL)
+                dirty_victim = current_entry;
+        }
+
+        if (oldest == NULL || current_entry->last_used < oldest->last_used
+            || (current_entry->last_used == oldest->last_used && oldest_dirty && !dirty))
+        {
+            oldest = current_entry;
+            oldest_dirty = dirty;
+        }
+    } while (list_front(&frame_list) != start);
+
+    return dirty_victim != NULL ? dirty_victim : oldest;
+}
+
+/* LRU 근사(Aging) : 새 프레임은 최근에 참조된 것으로 취급 */
+static void aging_on_allocate(struct frame_table_entry *fte)
+{
+    fte->age = AGE_INIT;
+}
+
+/* LRU 근사(Aging) : AGING_PERIOD마다 aging 스레드에서 호출.
+   모든 프레임의 카운터를 오른쪽으로 shift하고 그동안의 Reference Bit를 최상위 비트에 기록 */
+static void aging_age(void)
+{
+    struct frame_table_entry *current_entry;
+    struct list_elem *e;
+    bool accessed;
+
+    for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e))
+    {
+        current_entry = list_entry(e, struct frame_table_entry, elem);
+        if (!frame_is_evictable(current_entry))
+            continue;
+
+        accessed = pagedir_is_accessed(current_entry->owner->pagedir, current_entry->upage);
+        current_entry->age = (current_entry->age >> 1) | (accessed ? AGE_INIT : 0);
+        if (accessed)
+            pagedir_set_accessed(current_entry->owner->pagedir, current_entry->upage, false);
+    }
+}
+
+/* LRU 근사(Aging) : 카운터가 가장 작은 프레임을 선택 (같으면 clean 우선) */
+static struct frame_table_entry *aging_find_victim(void)
+{
+    struct frame_table_entry *victim = NULL;
+    bool victim_dirty = false;
+    struct frame_table_entry *current_entry;
+    struct list_elem *e;
+    bool dirty;
+
+    for (e = list_begin(&frame_list); e != list_end(&frame_list); e = list_next(e))
+    {
+        current_entry = list_entry(e, struct frame_table_entry, elem);
+        if (!frame_is_evictable(current_entry))
+            continue;
+
+        dirty = pagedir_is_dirty(current_entry->owner->pagedir, current_entry->upage);
+        if (victim == NULL || current_entry->age < victim->age
+            || (current_entry->age == victim->age && victim_dirty && !dirty))
+        {
+            victim = current_entry;
+            victim_dirty = dirty;
+        }
+    }
+
+    return victim;
+}
@@ -0,0 +1,23 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdbool.h>
+#include "vm/frame.h"
+
+/* 페이지 교체 정책 (Page Replacement Policy) 인터페이스
+   frame_lock을 잡은 상태에서 호출됨 */
+struct replace_policy
+{
+    const char *name;                                       // 커맨드라인 옵션 이름 (-evict=NAME)
+    void (*on_allocate)(struct frame_table_entry *fte);     // 프레임 할당 시 호출 (NULL 가능)
+    struct frame_table_entry *(*find_victim)(void);         // victim 프레임 선택
+    void (*age)(void);                                      // 주기적으로 호출 (NULL 가능)
+};
+
+/* 현재 선택된 교체 정책 (기본값 : clock) */
+extern const struct replace_policy *replace_policy;
+
+bool replace_policy_select(const char *name);
+void replace_policy_init(void);
+
+#endif /* POLICY_H */
@@ -1,6 +1,7 @@
 #include "vm/swap.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/malloc.h"
 #include <bitmap.h>
 #include <debug.h>
 #include <stdio.h>
@@ -10,6 +11,7 @@
 /* Swap Table 전역 변수 */
 struct swap_table swap_table;
 static struct lock swap_lock;
+static size_t swap_cursor;  /* 다음 slot 탐색 시작 위치 (next-fit) */
 
 
 void swap_table_init(void)
@@ -23,7 +25,8 @@ void swap_table_init(void)
     size_t swap_size = block_size(swap_table.swap_disk) / (PGSIZE / BLOCK_SECTOR_SIZE); 
     swap_table.slot_count = swap_size;                  // 슬롯 개수만큼 비트맵 생성
     swap_table.used_slots = bitmap_create(swap_size);
-    if (swap_table.used_slots == NULL)
+    swap_table.slot_refs = calloc(swap_size, sizeof *swap_table.slot_refs);
+    if (swap_table.used_slots == NULL || (swap_table.slot_refs == NULL && swap_size > 0))
         PANIC("Failed to create swap table!");
 
     /* 모든 슬롯을 비어 있음으로 초기화 */
@@ -31,21 +34,48 @@ void swap_table_init(void)
     lock_init(&swap_lock);
 }
 
-size_t swap_out(const void *frame)
+/* 연속된 CNT개의 빈 Swap Slot을 할당하고 첫 번째 slot index 반환 (없으면 BITMAP_ERROR).
+   가장 낮은 slot부터 찾지 않고 마지막 할당 위치(next-fit)부터 찾으므로,
+   연달아 evict된 페이지들이 swap disk에 연속으로 배치됨 */
+size_t swap_alloc_slots(size_t cnt)
 {
-    /* 사용 가능한 Swap Slot 찾기 */
+    size_t slot_idx;
+
     ASSERT(!lock_held_by_current_thread(&swap_lock));
     lock_acquire(&swap_lock);
-    size_t slot_idx = bitmap_scan_and_flip(swap_table.used_slots, 0, 1, false);
+    slot_idx = bitmap_scan_and_flip(swap_table.used_slots, swap_cursor, cnt, false);
+    if (slot_idx == BITMAP_ERROR && swap_cursor != 0)
+        slot_idx = bitmap_scan_and_flip(swap_table.used_slots, 0, cnt, false);
+    if (slot_idx != BITMAP_ERROR)
+    {
+        for (size_t i = 0; i < cnt; i++)
+            swap_table.slot_refs[slot_idx + i] = 1;
+        swap_cursor = slot_idx + cnt;
+        swap_table.slot_count -= cnt;
+    }
     lock_release(&swap_lock);
 
+    return slot_idx;
+}
+
+/* 페이지 데이터를 Swap Disk에 저장 : per Sector Unit */
+void swap_write_slot(size_t swap_index, const void *frame)
+{
+    ASSERT(bitmap_test(swap_table.used_slots, swap_index));
+
+    for (size_t i = 0; i < PGSIZE / BLOCK_SECTOR_SIZE; i++) 
+        block_write(swap_table.swap_disk, swap_index * (PGSIZE / BLOCK_SECTOR_SIZE) + i, (uint8_t *)frame + i * BLOCK_SECTOR_SIZE);
+}
+
+size_t swap_out(const void *frame)
+{
+    /* 사용 가능한 Swap Slot 찾기 */
+    size_t slot_idx = swap_alloc_slots(1);
+
     if (slot_idx == BITMAP_ERROR)
         PANIC("No available swap slots!");
-    swap_table.slot_count--;
 
-    /* 페이지 데이터를 Swap Disk에 저장 : per Sector Unit */
-    for (size_t i = 0; i < PGSIZE / BLOCK_SECTOR_SIZE; i++) 
-        block_write(swap_table.swap_disk, slot_idx * (PGSIZE / BLOCK_SECTOR_SIZE) + i, (uint8_t *)frame + i * BLOCK_SECTOR_SIZE);
+    swap_write_slot(slot_idx, frame);
     
     /* 저장된 Swap Slot의 인덱스 반환 */
     return slot_idx;
@@ -63,14 +93,35 @@ void swap_in(size_t swap_index, void *frame)
     ASSERT(!lock_held_by_current_thread(&swap_lock));
     lock_acquire(&swap_lock);
     swap_free_slot(swap_index);
+    swap_table.in_cnt++;
+    lock_release(&swap_lock);
+}
+
+/* fork로 자식이 같은 slot을 참조하게 되면 참조 수 증가 */
+void swap_dup_slot(size_t swap_index)
+{
+    lock_acquire(&swap_lock);
+    ASSERT(bitmap_test(swap_table.used_slots, swap_index));
+    swap_table.slot_refs[swap_index]++;
     lock_release(&swap_lock);
 }
 
+/* 참조 수를 줄이고, 더 이상 참조하는 SPT entry가 없으면 slot 반환 */
 void swap_free_slot(size_t swap_index)
 {
+    bool was_holding_lock = lock_held_by_current_thread(&swap_lock);
+
     ASSERT(swap_index < bitmap_size(swap_table.used_slots));
+    ASSERT(swap_table.slot_refs[swap_index] > 0);
 
-    /* Bitmap의 해당 bit를 해제 */
-    bitmap_set(swap_table.used_slots, swap_index, false);
-    swap_table.slot_count++;
+    if (!was_holding_lock)
+        lock_acquire(&swap_lock);
+    if (--swap_table.slot_refs[swap_index] == 0)
+    {
+        /* Bitmap의 해당 bit를 해제 */
+        bitmap_set(swap_table.used_slots, swap_index, false);
+        swap_table.slot_count++;
+    }
+    if (!was_holding_lock)
+        lock_release(&swap_lock);
 }
@@ -3,12 +3,15 @@
 
 #include "devices/block.h"
 #include <bitmap.h>
+#include <stdint.h>
 
 /* Swap Table 구조체 */
 struct swap_table {
     struct bitmap *used_slots;   /* Swap slot의 사용 여부를 관리하는 비트맵    */
     struct block *swap_disk;     /* Swap disk를 나타내는 블록 장치            */
     size_t slot_count;           /* Swap disk에 저장 가능한 총 swap slot의 수 */
+    uint16_t *slot_refs;         /* Slot을 참조하는 SPT entry 수 (fork 후 공유 가능) */
+    unsigned long long in_cnt;   /* Swap disk에서 읽어온 페이지 수 */
 };
 
 /* Swap Table 전역 변수 */
@@ -20,9 +23,12 @@ void swap_table_init(void);
 
 /* Swap In/Out 함수 */
 size_t swap_out(const void *frame);             /* 메모리의 page를 swap disk로 저장 */
+size_t swap_alloc_slots(size_t cnt);            /* 연속된 cnt개의 slot 할당 (clustered swap-out) */
+void swap_write_slot(size_t swap_index, const void *frame); /* 할당된 slot에 page 저장 */
 void swap_in(size_t swap_index, void *frame);   /* swap disk에서 page를 메모리로 복구 */
 
 /* Swap Slot 초기화 및 관리 함수 */
-void swap_free_slot(size_t swap_index);         /* 사용한 Swap Slot 해제 */
+void swap_dup_slot(size_t swap_index);          /* Swap Slot 참조 추가 (fork) */
+void swap_free_slot(size_t swap_index);         /* Swap Slot 참조 해제 (마지막 참조면 slot 반환) */
 
 #endif /* SWAP_H */
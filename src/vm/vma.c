@@ -0,0 +1,107 @@
+#include "vm/vma.h"
+#include <debug.h>
+#include <round.h>
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+static struct kmem_cache *vma_cache;   // struct vm_area
+
+void vma_init(void)
+{
+    vma_cache = kmem_cache_create("vm_area", sizeof (struct vm_area), NULL);
+}
+
+/* [START, START + LENGTH) 영역을 추가. 처음 READ_BYTES는 FILE의 OFS부터 읽고 나머지는 0.
+   길이가 0이거나 다른 영역과 겹치거나 메모리가 부족하면 false 반환 */
+bool vma_add(struct spt *spt, void *start, size_t length, struct file *file,
+             off_t ofs, size_t read_bytes, bool writable, enum vma_kind kind)
+{
+    struct vm_area *vma;
+    struct list_elem *e;
+
+    ASSERT(pg_ofs(start) == 0);
+    ASSERT(read_bytes <= length);
+
+    if (length == 0 || vma_overlaps(spt, start, length))
+        return false;
+    vma = kmem_cache_alloc(vma_cache);
+    if (vma == NULL)
+        return false;
+
+    vma->start = start;
+    vma->end = (uint8_t *)start + ROUND_UP(length, PGSIZE);
+    vma->file = file;
+    vma->ofs = ofs;
+    vma->read_bytes = read_bytes;
+    vma->writable = writable;
+    vma->kind = kind;
+
+    /* 시작 주소 순서를 유지하며 삽입 */
+    for (e = list_begin(&spt->areas); e != list_end(&spt->areas); e = list_next(e))
+        if (list_entry(e, struct vm_area, elem)->start > vma->start)
+            break;
+    list_insert(e, &vma->elem);
+    return true;
+}
+
+/* ADDR을 포함하는 영역을 반환 (없으면 NULL). 같은 영역을 연속으로 찾는 경우가 많으므로
+   마지막으로 찾은 영역을 먼저 확인 */
+struct vm_area *vma_find(struct spt *spt, const void *addr)
+{
+    struct list_elem *e;
+
+    if (spt->cache != NULL && spt->cache->start <= (uint8_t *)addr && (uint8_t *)addr < spt->cache->end)
+        return spt->cache;
+
+    for (e = list_begin(&spt->areas); e != list_end(&spt->areas); e = list_next(e))
+    {
+        struct vm_area *vma = list_entry(e, struct vm_area, elem);
+
+        if ((uint8_t *)addr < vma->start) // 정렬되어 있으므로 이후 영역은 확인할 필요 없음
+            break;
+        if ((uint8_t *)addr < vma->end)
+        {
+            spt->cache = vma;
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+/* [START, START + LENGTH)가 기존 영역과 겹치는지 확인 */
+bool vma_overlaps(struct spt *spt, const void *start, size_t length)
+{
+    const uint8_t *end = (const uint8_t *)start + ROUND_UP(length, PGSIZE);
+    struct list_elem *e;
+
+    for (e = list_begin(&spt->areas); e != list_end(&spt->areas); e = list_next(e))
+    {
+        struct vm_area *vma = list_entry(e, struct vm_area, elem);
+
+        if (vma->start >= end)
+            break;
+        if ((const uint8_t *)start < vma->end)
+            return true;
+    }
+    return false;
+}
+
+/* START에서 시작하는 영역을 제거 (영역 안의 spt_entry는 호출자가 제거) */
+void vma_remove(struct spt *spt, void *start)
+{
+    struct vm_area *vma = vma_find(spt, start);
+
+    if (vma == NULL || vma->start != start)
+        return;
+    if (spt->cache == vma)
+        spt->cache = NULL;
+    list_remove(&vma->elem);
+    kmem_cache_free(vma_cache, vma);
+}
+
+void vma_destroy(struct spt *spt)
+{
+    while (!list_empty(&spt->areas))
+        kmem_cache_free(vma_cache, list_entry(list_pop_front(&spt->areas), struct vm_area, elem));
+    spt->cache = NULL;
+}
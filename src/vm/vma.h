@@ -0,0 +1,50 @@
+#ifndef VMA_H
+#define VMA_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lib/kernel/hash.h"
+#include "filesys/off_t.h"
+
+struct file;
+
+/* 가상 메모리 영역(VMA) 종류 */
+enum vma_kind
+{
+    VMA_EXEC,   // 실행 파일 segment : 앞부분은 file에서 읽고 나머지는 0 (BSS)
+    VMA_MMAP    // mmap된 파일 : dirty 페이지는 file에 write-back
+};
+
+/* 가상 메모리 영역 : 같은 file, 권한을 가진 연속된 페이지 [start, end) */
+struct vm_area
+{
+    uint8_t *start;         // 첫 페이지 주소
+    uint8_t *end;           // 마지막 페이지 다음 주소
+    struct file *file;
+    off_t ofs;              // start에 대응하는 file offset
+    size_t read_bytes;      // start부터 file에서 읽는 byte 수 (이후는 0으로 채움)
+    bool writable;
+    enum vma_kind kind;
+    struct list_elem elem;
+};
+
+/* Supplemental Page Table : 영역 목록과, 실제로 접근(fault)되었거나 swap된 페이지의
+   spt_entry만 담는 sparse hash로 구성. 영역 안의 페이지는 처음 찾을 때 spt_entry가 만들어짐 */
+struct spt
+{
+    struct list areas;          // 시작 주소 순으로 정렬된 vm_area
+    struct vm_area *cache;      // 마지막으로 찾은 영역
+    struct hash pages;          // upage -> spt_entry
+};
+
+void vma_init(void);
+bool vma_add(struct spt *spt, void *start, size_t length, struct file *file,
+             off_t ofs, size_t read_bytes, bool writable, enum vma_kind kind);
+struct vm_area *vma_find(struct spt *spt, const void *addr);
+bool vma_overlaps(struct spt *spt, const void *start, size_t length);
+void vma_remove(struct spt *spt, void *start);
+void vma_destroy(struct spt *spt);
+
+#endif /* VMA_H */
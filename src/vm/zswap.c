@@ -0,0 +1,372 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* Pool 페이지는 ZSWAP_CHUNK 바이트 단위 chunk로 나누어 할당 (페이지당 64개, uint64_t bitmap으로 관리) */
+#define ZSWAP_CHUNK 64
+#define ZSWAP_CHUNKS (PGSIZE / ZSWAP_CHUNK)
+
+/* 압축 결과가 이 크기를 넘으면(2:1 미만) 압축하지 않고 swap disk로 보냄 */
+#define ZSWAP_MAX_LEN (PGSIZE / 2)
+
+/* 기본 pool 크기 : user pool의 1/8 (pages) */
+#define ZSWAP_DEFAULT_DIV 8
+
+/* LZ 압축기 (LZ4와 같은 형식)
+     sequence = token(literal 길이 4bit | match 길이 - 4 4bit) [literal 길이 확장]
+                literals [offset 2바이트 match 길이 확장]
+   마지막 sequence는 literal만 가지며, 복원된 크기가 PGSIZE가 되면 끝남 */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5      /* 페이지 끝의 이 바이트들은 항상 literal (4바이트 읽기가 페이지를 넘지 않도록) */
+
+/* 압축된 페이지 앞에는 참조 수(fork 후 공유 가능)를 기록 */
+#define ZSWAP_HDR sizeof (uint16_t)
+
+/* Handle = pool 페이지 index | 시작 chunk | chunk 수 - 1 */
+#define HANDLE(PAGE, START, CNT) ((size_t) (PAGE) << 12 | (START) << 6 | ((CNT) - 1))
+#define HANDLE_PAGE(H) ((H) >> 12)
+#define HANDLE_START(H) (((H) >> 6) & 0x3f)
+#define HANDLE_CNT(H) (((H) & 0x3f) + 1)
+
+struct zpage
+{
+    uint8_t *kpage;             // pool 페이지 (NULL이면 아직 할당되지 않음)
+    uint64_t used;              // 사용 중인 chunk bitmap
+};
+
+static struct zpage *zpages;    // pool 페이지 테이블 (max_pages개)
+static size_t max_pages;        // pool 크기 제한 (pages, 0이면 사용 안 함)
+static bool pool_size_set;      // -zswap 옵션으로 지정되었는지 여부
+static size_t pool_pages;       // 현재 할당된 pool 페이지 수
+static size_t stored_pages;     // 현재 pool에 저장된 페이지 수
+static struct lock zswap_lock;  // pool, 압축 버퍼, 통계 보호
+
+static uint16_t lz_table[1 << LZ_HASH_BITS];    // 4바이트 hash -> 페이지 내 위치
+static uint8_t lz_buf[ZSWAP_MAX_LEN - ZSWAP_HDR]; // 압축 결과 임시 버퍼
+
+/* 통계 */
+static unsigned long long store_cnt, reject_cnt, full_cnt, hit_cnt;
+static unsigned long long in_bytes, out_bytes;
+static size_t peak_pages;
+
+static size_t lz_compress(const uint8_t *src, uint8_t *dst, size_t dst_max);
+static void lz_decompress(const uint8_t *src, size_t src_len, uint8_t *dst);
+static size_t zpool_alloc(size_t cnt);
+static void zpool_free(size_t handle);
+static uint16_t *zswap_refs(size_t handle);
+
+/* SPEC(pages)으로 pool 크기 설정. 0이면 압축 swap을 사용하지 않음 */
+bool zswap_set_pool_size(const char *spec)
+{
+    if (spec == NULL || *spec < '0' || *spec > '9')
+        return false;
+    max_pages = atoi(spec);
+    pool_size_set = true;
+    return true;
+}
+
+void zswap_init(void)
+{
+    if (!pool_size_set)
+        max_pages = palloc_user_pool_size() / ZSWAP_DEFAULT_DIV;
+    lock_init(&zswap_lock);
+    if (max_pages == 0)
+        return;
+
+    zpages = calloc(max_pages, sizeof *zpages);
+    if (zpages == NULL)
+        PANIC("Failed to create zswap pool!");
+}
+
+/* FRAME을 압축하여 pool에 저장하고 handle을 반환.
+   압축률이 낮거나(ZSWAP_MAX_LEN 초과) pool이 가득 찬 경우 ZSWAP_ERROR 반환 */
+size_t zswap_store(const void *frame)
+{
+    size_t len, handle;
+
+    if (max_pages == 0)
+        return ZSWAP_ERROR;
+
+    lock_acquire(&zswap_lock);
+    len = lz_compress(frame, lz_buf, sizeof lz_buf);
+    if (len == 0)
+    {
+        reject_cnt++;
+        lock_release(&zswap_lock);
+        return ZSWAP_ERROR;
+    }
+
+    handle = zpool_alloc(DIV_ROUND_UP(ZSWAP_HDR + len, ZSWAP_CHUNK));
+    if (handle == ZSWAP_ERROR)
+    {
+        full_cnt++;
+        lock_release(&zswap_lock);
+        return ZSWAP_ERROR;
+    }
+    *zswap_refs(handle) = 1;
+    memcpy(zswap_refs(handle) + 1, lz_buf, len);
+
+    store_cnt++;
+    stored_pages++;
+    in_bytes += PGSIZE;
+    out_bytes += len;
+    lock_release(&zswap_lock);
+    return handle;
+}
+
+void zswap_load(size_t handle, void *frame)
+{
+    lock_acquire(&zswap_lock);
+    lz_decompress((uint8_t *) (zswap_refs(handle) + 1), HANDLE_CNT(handle) * ZSWAP_CHUNK - ZSWAP_HDR, frame);
+    hit_cnt++;
+    if (--*zswap_refs(handle) == 0)
+        zpool_free(handle);
+    lock_release(&zswap_lock);
+}
+
+/* fork로 자식이 같은 압축 페이지를 참조하게 되면 참조 수 증가 */
+void zswap_dup(size_t handle)
+{
+    lock_acquire(&zswap_lock);
+    ASSERT(*zswap_refs(handle) > 0);
+    ++*zswap_refs(handle);
+    lock_release(&zswap_lock);
+}
+
+void zswap_free(size_t handle)
+{
+    lock_acquire(&zswap_lock);
+    if (--*zswap_refs(handle) == 0)
+        zpool_free(handle);
+    lock_release(&zswap_lock);
+}
+
+/* Prints compressed swap cache statistics. */
+void zswap_print_stats(void)
+{
+    unsigned long long ratio = out_bytes != 0 ? in_bytes * 100 / out_bytes : 0;
+    unsigned long long miss_cnt = swap_table.in_cnt;
+    unsigned long long hit_rate = hit_cnt + miss_cnt != 0 ? hit_cnt * 100 / (hit_cnt + miss_cnt) : 0;
+
+    printf("Zswap: %llu stores, %llu rejected, %llu pool full, compression ratio %llu.%02llu, "
+           "pool %zu/%zu pages (peak %zu)\n",
+           store_cnt, reject_cnt, full_cnt, ratio / 100, ratio % 100,
+           pool_pages, max_pages, peak_pages);
+    printf("Zswap: %llu hits, %llu swap disk reads (hit rate %llu%%)\n",
+           hit_cnt, miss_cnt, hit_rate);
+}
+
+/* HANDLE의 참조 수 위치 (압축된 데이터는 바로 뒤에 이어짐) */
+static uint16_t *zswap_refs(size_t handle)
+{
+    ASSERT(HANDLE_PAGE(handle) < max_pages);
+    return (uint16_t *) (zpages[HANDLE_PAGE(handle)].kpage + HANDLE_START(handle) * ZSWAP_CHUNK);
+}
+
+/* pool에서 연속된 CNT개의 chunk를 할당 (first-fit). zswap_lock을 잡은 상태에서 호출 */
+static size_t zpool_alloc(size_t cnt)
+{
+    uint64_t mask = ((uint64_t) 1 << cnt) - 1;
+    size_t empty = max_pages;
+    size_t i, start;
+
+    ASSERT(cnt > 0 && cnt < ZSWAP_CHUNKS);
+
+    for (i = 0; i < max_pages; i++)
+    {
+        struct zpage *zp = &zpages[i];
+
+        if (zp->kpage == NULL)
+        {
+            if (empty == max_pages)
+                empty = i;
+            continue;
+        }
+        for (start = 0; start + cnt <= ZSWAP_CHUNKS; start++)
+            if ((zp->used & (mask << start)) == 0)
+            {
+                zp->used |= mask << start;
+                return HANDLE(i, start, cnt);
+            }
+    }
+
+    /* 빈 공간이 없으면 pool 페이지를 새로 할당 (kernel pool이 부족해도 실패) */
+    if (empty == max_pages || (zpages[empty].kpage = palloc_get_page(0)) == NULL)
+        return ZSWAP_ERROR;
+    zpages[empty].used = mask;
+    pool_pages++;
+    if (pool_pages > peak_pages)
+        peak_pages = pool_pages;
+    return HANDLE(empty, 0, cnt);
+}
+
+/* HANDLE의 chunk를 해제하고, 비게 된 pool 페이지는 반환. zswap_lock을 잡은 상태에서 호출 */
+static void zpool_free(size_t handle)
+{
+    struct zpage *zp = &zpages[HANDLE_PAGE(handle)];
+    uint64_t mask = (((uint64_t) 1 << HANDLE_CNT(handle)) - 1) << HANDLE_START(handle);
+
+    ASSERT(HANDLE_PAGE(handle) < max_pages);
+    ASSERT((zp->used & mask) == mask);
+
+    zp->used &= ~mask;
+    stored_pages--;
+    if (zp->used == 0)
+    {
+        palloc_free_page(zp->kpage);
+        zp->kpage = NULL;
+        pool_pages--;
+    }
+}
+
+static uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static size_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* 길이 확장 바이트(255 단위) 기록 */
+static size_t lz_put_len(uint8_t *dst, size_t op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        dst[op++] = 255;
+    dst[op++] = len;
+    return op;
+}
+
+static size_t lz_get_len(const uint8_t *src, size_t src_len, size_t ip, size_t *len)
+{
+    uint8_t b;
+
+    do
+    {
+        if (ip >= src_len)
+            PANIC("zswap: corrupted compressed page");
+        b = src[ip++];
+        *len += b;
+    } while (b == 255);
+    return ip;
+}
+
+/* sequence 하나(LIT_LEN바이트 literal + MATCH_LEN바이트 match)를 DST[*OP]에 기록.
+   MATCH_LEN이 0이면 마지막 sequence. DST_MAX를 넘으면 false 반환 */
+static bool lz_emit(uint8_t *dst, size_t *op, size_t dst_max, const uint8_t *lit,
+                    size_t lit_len, size_t offset, size_t match_len)
+{
+    size_t ml = match_len != 0 ? match_len - LZ_MIN_MATCH : 0;
+    size_t o = *op;
+    uint8_t *token;
+
+    if (o + 1 + (lit_len / 255 + 1) + lit_len + 2 + (ml / 255 + 1) > dst_max)
+        return false;
+
+    token = &dst[o++];
+    *token = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+    if (lit_len >= 15)
+        o = lz_put_len(dst, o, lit_len - 15);
+    memcpy(dst + o, lit, lit_len);
+    o += lit_len;
+
+    if (match_len != 0)
+    {
+        dst[o++] = offset & 0xff;
+        dst[o++] = offset >> 8;
+        if (ml >= 15)
+            o = lz_put_len(dst, o, ml - 15);
+    }
+    *op = o;
+    return true;
+}
+
+/* PGSIZE 바이트의 SRC를 DST에 압축하고 압축된 크기를 반환. DST_MAX 안에 들어가지 않으면 0 반환.
+   lz_table의 이전 값은 매번 초기화하지 않음 : 후보 위치는 항상 실제 바이트를 비교해 검증 */
+static size_t lz_compress(const uint8_t *src, uint8_t *dst, size_t dst_max)
+{
+    const size_t limit = PGSIZE - LZ_LAST_LITERALS;
+    size_t ip = 0, anchor = 0, op = 0;
+
+    while (ip + LZ_MIN_MATCH <= limit)
+    {
+        uint32_t v = lz_read32(src + ip);
+        size_t h = lz_hash(v);
+        size_t cand = lz_table[h];
+        size_t len;
+
+        lz_table[h] = ip;
+        if (cand >= ip || lz_read32(src + cand) != v)
+        {
+            if (++ip - anchor > dst_max) // literal만으로 이미 DST_MAX 초과
+                return 0;
+            continue;
+        }
+
+        for (len = LZ_MIN_MATCH; ip + len < limit && src[cand + len] == src[ip + len]; len++)
+            continue;
+        if (!lz_emit(dst, &op, dst_max, src + anchor, ip - anchor, ip - cand, len))
+            return 0;
+        ip += len;
+        anchor = ip;
+    }
+
+    if (!lz_emit(dst, &op, dst_max, src + anchor, PGSIZE - anchor, 0, 0))
+        return 0;
+    return op;
+}
+
+/* SRC(최대 SRC_LEN 바이트)를 PGSIZE 바이트의 DST로 복원 */
+static void lz_decompress(const uint8_t *src, size_t src_len, uint8_t *dst)
+{
+    size_t ip = 0, op = 0;
+
+    for (;;)
+    {
+        size_t lit_len, offset, len;
+        uint8_t token;
+
+        if (ip >= src_len)
+            PANIC("zswap: corrupted compressed page");
+        token = src[ip++];
+
+        lit_len = token >> 4;
+        if (lit_len == 15)
+            ip = lz_get_len(src, src_len, ip, &lit_len);
+        if (ip + lit_len > src_len || op + lit_len > PGSIZE)
+            PANIC("zswap: corrupted compressed page");
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (op == PGSIZE)
+            break;
+
+        if (ip + 2 > src_len)
+            PANIC("zswap: corrupted compressed page");
+        offset = src[ip] | src[ip + 1] << 8;
+        ip += 2;
+        len = token & 15;
+        if (len == 15)
+            ip = lz_get_len(src, src_len, ip, &len);
+        len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || op + len > PGSIZE)
+            PANIC("zswap: corrupted compressed page");
+
+        /* match가 자기 자신과 겹칠 수 있으므로 바이트 단위로 복사 */
+        for (; len > 0; len--, op++)
+            dst[op] = dst[op - offset];
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef ZSWAP_H
+#define ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed Swap Cache : swap disk 앞에서 evict된 페이지를 LZ 압축하여
+   kernel 페이지로 이루어진 크기 제한 pool에 보관.
+   압축이 잘 되지 않거나 pool이 가득 찬 경우에만 swap disk로 내려감 */
+
+#define ZSWAP_ERROR ((size_t) -1)
+
+bool zswap_set_pool_size(const char *spec);     /* "-zswap=PAGES" 옵션 처리 */
+void zswap_init(void);
+size_t zswap_store(const void *frame);          /* 압축 저장 후 handle 반환 (실패 시 ZSWAP_ERROR) */
+void zswap_load(size_t handle, void *frame);    /* handle의 페이지를 FRAME에 복원 후 참조 해제 */
+void zswap_dup(size_t handle);                  /* 참조 추가 (fork) */
+void zswap_free(size_t handle);                 /* 복원 없이 참조 해제 (마지막 참조면 pool에서 제거) */
+void zswap_print_stats(void);
+
+#endif /* ZSWAP_H */